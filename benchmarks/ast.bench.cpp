@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include "ast.h"
+#include "astArena.h"
+#include "tokenBuffer.h"
+
+// Programs of `statements` lines like `1 + 2 * 3`, built once with shared_ptr
+// nodes and once in an AstArena. Tokens are shared between the lines so only
+// the cost of the nodes is measured.
+static const pToken numberToken = token::make(TokenType::NUMBER, "1");
+static const pToken plusToken = token::make(TokenType::PLUS, "+");
+static const pToken starToken = token::make(TokenType::ASTERISK, "*");
+
+static pAstProgram buildShared(size_t statements) {
+  auto program = std::make_shared<AstProgram>();
+  for (size_t i = 0; i < statements; ++i) {
+    auto product = std::make_shared<AstInfixExpression>(starToken,
+      std::make_shared<AstNumber>(numberToken, 2),
+      std::make_shared<AstNumber>(numberToken, 3));
+    auto sum = std::make_shared<AstInfixExpression>(plusToken,
+      std::make_shared<AstNumber>(numberToken, 1), product);
+    program->statements.push_back(std::make_shared<AstExpressionStatement>(plusToken, sum));
+  }
+  return program;
+}
+
+static ast::NodeIndex buildArena(AstArena& arena, size_t statements) {
+  std::vector<ast::NodeIndex> list;
+  for (size_t i = 0; i < statements; ++i) {
+    auto product = arena.add(ast::Kind::INFIX, starToken,
+      arena.addNumber(numberToken, 2), arena.addNumber(numberToken, 3));
+    auto sum = arena.add(ast::Kind::INFIX, plusToken, arena.addNumber(numberToken, 1), product);
+    list.push_back(arena.add(ast::Kind::EXPRESSION_STATEMENT, plusToken, sum));
+  }
+  return arena.add(ast::Kind::PROGRAM, nullptr, arena.addList(list));
+}
+
+// nodes per statement plus the program
+static size_t nodeCount(size_t statements) {
+  return statements * 6 + 1;
+}
+
+static void BM_BuildSharedAst(benchmark::State& state) {
+  size_t statements = state.range(0);
+  size_t heap = 0;
+
+  for (auto _ : state) {
+    auto before = mallinfo2().uordblks;
+    auto program = buildShared(statements);
+    heap = mallinfo2().uordblks - before;
+    benchmark::DoNotOptimize(program.get());
+  }
+  state.SetItemsProcessed(state.iterations() * nodeCount(statements));
+  state.counters["bytes/node"] = double(heap) / nodeCount(statements);
+}
+BENCHMARK(BM_BuildSharedAst)->Arg(1000)->Arg(100000);
+
+static void BM_BuildArenaAst(benchmark::State& state) {
+  size_t statements = state.range(0);
+  AstArena arena;
+
+  for (auto _ : state) {
+    arena.clear();
+    benchmark::DoNotOptimize(buildArena(arena, statements));
+  }
+  state.SetItemsProcessed(state.iterations() * nodeCount(statements));
+  state.counters["bytes/node"] = double(arena.bytes()) / arena.size();
+}
+BENCHMARK(BM_BuildArenaAst)->Arg(1000)->Arg(100000);
+
+static void BM_WalkSharedAst(benchmark::State& state) {
+  auto program = buildShared(state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(program->typeToString(0).size());
+  }
+  state.SetItemsProcessed(state.iterations() * nodeCount(state.range(0)));
+}
+BENCHMARK(BM_WalkSharedAst)->Arg(1000);
+
+static void BM_WalkArenaAst(benchmark::State& state) {
+  AstArena arena;
+  auto program = buildArena(arena, state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(arena.typeToString(program).size());
+  }
+  state.SetItemsProcessed(state.iterations() * nodeCount(state.range(0)));
+}
+BENCHMARK(BM_WalkArenaAst)->Arg(1000);
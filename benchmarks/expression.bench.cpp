@@ -0,0 +1,32 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "preparser.h"
+#include "processor.h"
+
+// one expression of `terms` numbers joined by operators of every precedence
+static std::string chain(size_t terms) {
+  static const char* operators[] = { " + ", " * ", " - ", " / ", " < ", " == " };
+  std::string src = "1";
+  for (size_t i = 1; i < terms; ++i) {
+    src += operators[i % 6] + std::to_string(i % 9 + 1);
+  }
+  return src + "\n";
+}
+
+static void BM_ParseArithmeticChain(benchmark::State& state) {
+  auto lexer = Lexer(chain(state.range(0)));
+  lexer.generateTokens();
+  PreParser preparser(lexer.tokens);
+  preparser.prepareFromStart();
+  auto statement = std::static_pointer_cast<PreToken>(preparser.scoped->tokens.front());
+  auto expression = statement->tokens.front();
+
+  for (auto _ : state) {
+    ExpressionProc processor(preparser.scoped);
+    pParserError error;
+    benchmark::DoNotOptimize(processor.parse(expression, error).get());
+  }
+  // numbers and operators
+  state.SetItemsProcessed(state.iterations() * (state.range(0) * 2 - 1));
+}
+BENCHMARK(BM_ParseArithmeticChain)->RangeMultiplier(8)->Range(8, 4096);
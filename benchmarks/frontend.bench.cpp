@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <thread>
+#include "frontend.h"
+
+// document i of a set, each with words of its own and some problems
+static std::string document(size_t i, size_t sections) {
+  std::string word(i % 26 + 1, 'a' + i % 26);
+  std::string src = "# " + word + " _x_\n";
+  for (size_t s = 0; s < sections; ++s) {
+    std::string section(s % 26 + 1, 'a' + s % 26);
+    src += "## " + section + " " + word + "\n"
+      + word + " _1_ * " + section + " " + word + " - 2\n"
+      + section + " " + word + " + 1 == 3\n"
+      + (s % 10 == 0 ? "missing + 1\n" : "");
+  }
+  return src;
+}
+
+static std::string summary(const Compilation& compilation) {
+  auto result = compilation.program->toString();
+  for (auto& diagnostic : compilation.diagnostics) {
+    result += std::to_string(diagnostic.line) + diagnostic.msg;
+  }
+  return result;
+}
+
+// range(0) documents compiled at once on as many threads, every result
+// checked against a serial compile of the same document
+static void BM_CompileConcurrently(benchmark::State& state) {
+  size_t count = state.range(0);
+  std::vector<std::string> sources;
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < count; ++i) {
+    sources.push_back(document(i, 200));
+    expected.push_back(summary(frontend::compile(sources.back())));
+  }
+
+  for (auto _ : state) {
+    std::vector<std::string> results(count);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; ++i) {
+      threads.emplace_back([&, i]() { results[i] = summary(frontend::compile(sources[i])); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (results != expected) {
+      state.SkipWithError("a concurrent compile differs from the serial one");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CompileConcurrently)->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
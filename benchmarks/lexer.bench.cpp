@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "scan.h"
+#include "blocks.h"
+
+// prose-like Able document: long phrases, declarations and some arithmetic
+static std::string proseDocument(size_t lines) {
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    switch (i % 4) {
+      case 0:
+        src += "# Add _first value_ times _second value_ to the accumulated result\n";
+        break;
+      case 1:
+        src += "accumulated result of the calculation = 12.5 * previous result + 300\n";
+        break;
+      case 2:
+        src += "Add the number of apples times the price of apples to accumulated result\n";
+        break;
+      default:
+        src += "\n";
+        break;
+    }
+  }
+  return src;
+}
+
+static const scan::Kernels* kernelsFor(int index) {
+  switch (index) {
+    case 0:
+      return &scan::scalar();
+    case 1:
+      return &scan::sse2();
+    default:
+      return &scan::avx2();
+  }
+}
+
+static bool supported(int index) {
+  return index == 0 || (index == 1 && scan::hasSse2()) || (index == 2 && scan::hasAvx2());
+}
+
+static void BM_LexTokenBuffer(benchmark::State& state) {
+  if (!supported(state.range(0))) {
+    state.SkipWithError("kernels not supported by this cpu");
+    return;
+  }
+
+  auto src = proseDocument(10000);
+  auto lexer = Lexer::borrow(src);
+  lexer.kernels = kernelsFor(state.range(0));
+  state.SetLabel(lexer.kernels->name);
+
+  for (auto _ : state) {
+    lexer.generateTokenBuffer();
+    benchmark::DoNotOptimize(lexer.buffer.size());
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_LexTokenBuffer)->DenseRange(0, 2);
+
+static void BM_WordRun(benchmark::State& state) {
+  if (!supported(state.range(0))) {
+    state.SkipWithError("kernels not supported by this cpu");
+    return;
+  }
+
+  std::string word(state.range(1), 'a');
+  auto kernels = kernelsFor(state.range(0));
+  state.SetLabel(kernels->name);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernels->wordRun(word.data(), word.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * word.size());
+}
+BENCHMARK(BM_WordRun)->ArgsProduct({ { 0, 1, 2 }, { 8, 64, 1024 } });
+
+static void BM_UntilNewline(benchmark::State& state) {
+  if (!supported(state.range(0))) {
+    state.SkipWithError("kernels not supported by this cpu");
+    return;
+  }
+
+  auto src = std::string(state.range(1), 'x') + "\n";
+  auto kernels = kernelsFor(state.range(0));
+  state.SetLabel(kernels->name);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernels->untilNewline(src.data(), src.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_UntilNewline)->ArgsProduct({ { 0, 1, 2 }, { 64, 1024 } });
+
+static void BM_LexThreads(benchmark::State& state) {
+  auto src = proseDocument(200000);
+  auto lexer = Lexer::borrow(src);
+  lexer.threads = state.range(0);
+  state.SetLabel(std::to_string(lexer.threads) + " threads");
+
+  for (auto _ : state) {
+    lexer.generateTokenBuffer();
+    benchmark::DoNotOptimize(lexer.buffer.size());
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_LexThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// the same document shape in different scripts
+static std::string scriptDocument(int script, size_t lines) {
+  const char* phrases[][2] = {
+    { "# Add _first value_ times _second value_ to the accumulated result\n",
+      "Add the number of apples times the price of apples to accumulated result\n" },
+    { "# Lisää _ensimmäinen arvo_ kertaa _toinen arvo_ kertyneeseen tulokseen\n",
+      "Lisää omenoiden määrä kertaa omenoiden hinta kertyneeseen tulokseen\n" },
+    { "# Прибавить _первое значение_ раз _второе значение_ к результату\n",
+      "Прибавить количество яблок раз цена яблок к накопленному результату\n" },
+    { "# Add _first value_ times _second value_ to the accumulated result\n",
+      "Lisää omenoiden määrä kertaa 日本語 price of apples to Straße result\n" },
+  };
+
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    src += phrases[script][i % 2];
+  }
+  return src;
+}
+
+static void BM_LexScript(benchmark::State& state) {
+  const char* names[] = { "english", "finnish", "russian", "mixed" };
+  auto src = scriptDocument(state.range(0), 10000);
+  auto lexer = Lexer::borrow(src);
+  state.SetLabel(names[state.range(0)]);
+
+  for (auto _ : state) {
+    lexer.generateTokenBuffer();
+    benchmark::DoNotOptimize(lexer.buffer.size());
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+  state.counters["tokens"] = lexer.buffer.size();
+}
+BENCHMARK(BM_LexScript)->DenseRange(0, 3);
+
+// documentation heavy: every statement comes with a fenced example
+static std::string documentedDocument(size_t sections) {
+  std::string src;
+  for (size_t i = 0; i < sections; ++i) {
+    src += "# Add _first value_ times _second value_ to the accumulated result\n"
+      "\n"
+      "```js\n"
+      "function add(first, second, result) { return first * second + result; }\n"
+      "const total = add(3, 5, 2); // 17\n"
+      "console.log(`total is ${total}`);\n"
+      "```\n"
+      "\n"
+      "accumulated result = first value * second value + accumulated result\n";
+  }
+  return src;
+}
+
+static void BM_LexSkipBlocks(benchmark::State& state) {
+  auto src = documentedDocument(5000);
+  auto lexer = Lexer::borrow(src);
+  lexer.skipBlocks = state.range(0);
+  state.SetLabel(lexer.skipBlocks ? "skip blocks" : "lex everything");
+
+  for (auto _ : state) {
+    lexer.generateTokenBuffer();
+    benchmark::DoNotOptimize(lexer.buffer.size());
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+  state.counters["tokens"] = lexer.buffer.size();
+}
+BENCHMARK(BM_LexSkipBlocks)->Arg(0)->Arg(1);
+
+static void BM_ClassifyBlocks(benchmark::State& state) {
+  auto src = documentedDocument(5000);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(blocks::classify(src).size());
+  }
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_ClassifyBlocks);
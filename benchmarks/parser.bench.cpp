@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "parser.h"
+#include "preparser.h"
+
+// a vocabulary of `sections` headings with a definition and some uses each
+static std::string vocabulary(size_t sections) {
+  std::string src = "# vocabulary\n";
+  for (size_t i = 0; i < sections; ++i) {
+    std::string name;
+    for (size_t n = i; n > 0 || name.empty(); n /= 26) {
+      name += char('a' + n % 26);
+    }
+    src += "## section " + name + "\n"
+      "### entry " + name + " _x_\n";
+    for (int line = 0; line < 16; ++line) {
+      src += "entry " + name + " _1_ + 2 * section " + name + " - vocabulary / 4\n";
+    }
+  }
+  return src;
+}
+
+// range(0) threads in the pool, 0 parses serially. A heading is nested in
+// the one before it unless it is shallower, so the sections are not
+// siblings but a chain 1024 scopes deep. Each scope is still a task of its
+// own: it starts its nested scope before it parses its own lines, so the
+// lines of all sections are parsed concurrently.
+static void BM_ParseSections(benchmark::State& state) {
+  auto lexer = Lexer(vocabulary(512));
+  lexer.generateTokens();
+  PreParser preparser(lexer.tokens);
+  preparser.prepareFromStart();
+  std::unique_ptr<ThreadPool> pool;
+  if (state.range(0) > 0) {
+    pool = std::make_unique<ThreadPool>(state.range(0));
+  }
+
+  for (auto _ : state) {
+    Parser parser(preparser.scoped);
+    parser.pool = pool.get();
+    parser.parseScope();
+    benchmark::DoNotOptimize(parser.scope.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 512);
+}
+BENCHMARK(BM_ParseSections)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,146 @@
+#include <benchmark/benchmark.h>
+#include "lexer.h"
+#include "preparser.h"
+#include "parser.h"
+
+// short assignments and calls, the bulk of a typical Able program
+static std::string assignments(size_t lines) {
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    src += i % 2 == 0 ? "total value = 2 * 3 + 1\n" : "total value + 4\n";
+  }
+  return src;
+}
+
+static void BM_PreparseAssignments(benchmark::State& state) {
+  auto src = assignments(state.range(0));
+  auto lexer = Lexer(src);
+  lexer.generateTokens();
+
+  for (auto _ : state) {
+    PreParser preparser(lexer.tokens);
+    preparser.prepareFromStart();
+    benchmark::DoNotOptimize(preparser.scoped.get());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_PreparseAssignments)->RangeMultiplier(4)->Range(256, 16384)->Complexity();
+
+// a declaration followed by expression statements calling it
+static std::string calls(size_t lines) {
+  std::string src = "# total value\n";
+  for (size_t i = 0; i < lines; ++i) {
+    src += "total value + 2 * 3 - 1\n";
+  }
+  return src;
+}
+
+static void BM_PreparseCalls(benchmark::State& state) {
+  auto lexer = Lexer(calls(4096));
+  lexer.generateTokens();
+
+  for (auto _ : state) {
+    PreParser preparser(lexer.tokens);
+    preparser.prepareFromStart();
+    benchmark::DoNotOptimize(preparser.scoped.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_PreparseCalls);
+
+static void BM_ParseCalls(benchmark::State& state) {
+  auto lexer = Lexer(calls(4096));
+  lexer.generateTokens();
+  PreParser preparser(lexer.tokens);
+  preparser.prepareFromStart();
+
+  for (auto _ : state) {
+    Parser parser(preparser.scoped);
+    parser.parseScope();
+    benchmark::DoNotOptimize(parser.scope.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_ParseCalls);
+
+static void BM_PreparseDispatch(benchmark::State& state) {
+  auto lexer = Lexer(calls(4096));
+  lexer.generateTokens();
+  state.SetLabel(state.range(0) ? "runtime processors" : "static pipeline");
+
+  for (auto _ : state) {
+    PreParser preparser(lexer.tokens);
+    if (state.range(0)) {
+      preparser.addProcessor(std::make_shared<DefinitionProcessor>());
+      preparser.addProcessor(std::make_shared<AssignmentProcessor>());
+      preparser.addProcessor(std::make_shared<ExpressionStatementProcessor>());
+    }
+    preparser.prepareFromStart();
+    benchmark::DoNotOptimize(preparser.scoped.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_PreparseDispatch)->Arg(0)->Arg(1);
+
+// resolves the last call of a long expression from the innermost scope of
+// 300 declarations at depths 1 to 6, the name is declared in the outermost
+static void BM_ResolveCall(benchmark::State& state) {
+  std::string src;
+  for (int depth = 1; depth <= 6; ++depth) {
+    for (int i = 0; i < 50; ++i) {
+      src += std::string(depth, '#') + " name " + std::string(i % 26 + 1, 'a') + "\n";
+    }
+  }
+  src += "1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + name a\n";
+  auto lexer = Lexer(src);
+  lexer.generateTokens();
+  PreParser preparser(lexer.tokens);
+  preparser.prepareFromStart();
+
+  auto scope = preparser.scoped.get();
+  while (!scope->narrower.empty()) {
+    scope = scope->narrowerScope(scope->narrower.size() - 1);
+  }
+  auto statement = std::static_pointer_cast<PreToken>(scope->tokens.back());
+  TokenSpan expression(std::static_pointer_cast<PreToken>(statement->tokens.front())->tokens);
+  auto processor = CallProc(preparser.arena->at<PreScope>(scope->index));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(processor.checkLine(expression, expression.end() - 1));
+  }
+}
+BENCHMARK(BM_ResolveCall);
+
+// resolves a call among `range` phrases assigned in one scope, the called
+// phrase is assigned last
+static void BM_ResolveCallManyPhrases(benchmark::State& state) {
+  std::string src;
+  for (int i = 0; i < state.range(0); ++i) {
+    std::string word;
+    for (int n = i; n > 0 || word.empty(); n /= 26) {
+      word += char('a' + n % 26);
+    }
+    src += word + " name = 1\n";
+  }
+  src += "called name = 1\n"
+    "called name + 1\n";
+  auto lexer = Lexer(src);
+  lexer.generateTokens();
+  PreParser preparser(lexer.tokens);
+  preparser.prepareFromStart();
+
+  auto scope = preparser.scoped.get();
+  while (!scope->narrower.empty()) {
+    scope = scope->narrowerScope(scope->narrower.size() - 1);
+  }
+  auto statement = std::static_pointer_cast<PreToken>(scope->tokens.back());
+  TokenSpan expression(std::static_pointer_cast<PreToken>(statement->tokens.front())->tokens);
+  auto processor = CallProc(preparser.arena->at<PreScope>(scope->index));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(processor.checkLine(expression, expression.begin()));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ResolveCallManyPhrases)->RangeMultiplier(8)->Range(8, 4096)->Complexity();
@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "frontend.h"
+#include "sourceManager.h"
+
+static std::string assignments(size_t lines) {
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    src += i % 2 == 0 ? "total value = 2 * 3 + 1\n" : "total value + 4\n";
+  }
+  return src;
+}
+
+static std::string writeTemporary(const std::string& text) {
+  char path[] = "/tmp/sourceManagerXXXXXX";
+  close(mkstemp(path));
+  std::ofstream(path, std::ios::binary) << text;
+  return path;
+}
+
+// the same document compiled from a string read into memory, and from the
+// mapped file without a copy
+static void BM_CompileSource(benchmark::State& state) {
+  auto text = assignments(20000);
+  auto path = writeTemporary(text);
+  state.SetLabel(state.range(0) ? "mapped file" : "string");
+
+  for (auto _ : state) {
+    if (state.range(0)) {
+      SourceManager sources;
+      benchmark::DoNotOptimize(frontend::compile(sources, sources.open(path)).program.get());
+    } else {
+      std::ifstream file(path, std::ios::binary);
+      std::string src((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      benchmark::DoNotOptimize(frontend::compile(std::move(src)).program.get());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+  std::remove(path.c_str());
+}
+BENCHMARK(BM_CompileSource)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// positions of locations spread over range(0) lines, after the line index
+// is built
+static void BM_SourcePosition(benchmark::State& state) {
+  SourceManager sources;
+  auto file = sources.add("", assignments(state.range(0)));
+  auto size = sources.text(file).size();
+  sources.position(sources.location(file));
+
+  u_int offset = 0;
+  for (auto _ : state) {
+    offset = (offset + 7919) % size;
+    benchmark::DoNotOptimize(sources.position(sources.location(file, offset)));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_SourcePosition)->RangeMultiplier(16)->Range(16, 1 << 20)->Complexity(benchmark::oLogN);
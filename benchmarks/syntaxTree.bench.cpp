@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include "frontend.h"
+#include "syntaxTree.h"
+
+// a 10k line document of declarations and statements using them
+static std::string document() {
+  std::string src;
+  for (size_t i = 0; i < 10000; ++i) {
+    src += i % 4 == 0 ? "# name " + std::to_string(i % 97 + 1) + "\n"
+      : "value = 2 * 3 + name " + std::to_string(i % 97 + 1) + "\n";
+  }
+  return src;
+}
+
+// one line in the middle edited back and forth, the tree is reparsed each time
+static void BM_ReparseEditedLine(benchmark::State& state) {
+  auto tree = SyntaxTree::parse(document());
+  auto line = tree.line(5000);
+
+  bool inserted = false;
+  for (auto _ : state) {
+    tree = inserted ? tree.edit({ line.offset + 1, 1, "" }) : tree.edit({ line.offset + 1, 0, "x" });
+    inserted = !inserted;
+    benchmark::DoNotOptimize(tree.root.get());
+  }
+}
+BENCHMARK(BM_ReparseEditedLine);
+
+// what the edit saves: a new tree from scratch, and the whole pipeline
+static void BM_ParseTree(benchmark::State& state) {
+  auto src = document();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyntaxTree::parse(src).root.get());
+  }
+}
+BENCHMARK(BM_ParseTree)->Unit(benchmark::kMillisecond);
+
+static void BM_CompileDocument(benchmark::State& state) {
+  auto src = document();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(frontend::compile(src).program.get());
+  }
+}
+BENCHMARK(BM_CompileDocument)->Unit(benchmark::kMillisecond);
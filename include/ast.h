@@ -38,7 +38,8 @@ struct AstExpression: AstNode {
   AstExpression(std::shared_ptr<Token> t = nullptr): AstNode(t) {}
 };
 
-typedef std::vector<std::shared_ptr<AstStatement>> Statements;
+typedef std::shared_ptr<AstStatement> pAstStatement;
+typedef std::vector<pAstStatement> Statements;
 
 struct AstProgram: AstNode {
   Statements statements;
@@ -80,6 +81,10 @@ struct AstNumber: AstExpression {
   double value;
 
   std::string toString() {
+    return toString(value);
+  }
+
+  static std::string toString(double value) {
     std::string nbr = std::to_string(value);
     if (nbr.size() != 1) {
       for (auto it = nbr.end() - 1; (*it) == '0' || (*it) == '.'; --it) {
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.h"
+
+// Compact AST: one contiguous array of fixed size nodes with a kind tag and
+// child indices, owned by one AstArena per compilation. Nodes are not
+// reference counted and there are no vtables, passes switch on the kind or go
+// through visit(). The tokens of nodes are the one shared part: `tokens`
+// holds a pToken for every node that has one, shared with the pre tokens the
+// node was made from. Programs and parameter lists are stored in `lists` as a
+// count followed by the node indices.
+namespace ast {
+
+  typedef uint32_t NodeIndex;
+  constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+  enum class Kind : uint8_t {
+    PROGRAM,              // a: list of statements
+    EXPRESSION_STATEMENT, // a: expression
+    DECLARATION,          // a: name, b: scope program
+    ASSIGNMENT,           // a: list of parameters, b: value
+    NUMBER,               // a: index in numbers
+    PREFIX,               // a: right
+    INFIX,                // a: left, b: right
+    CALL,                 // token: the PreIdentifier that is called
+    IDENTIFIER,           // token: the PreIdentifier
+    PARAMETER,
+  };
+
+  struct Node {
+    Kind kind;
+    uint32_t token = NO_NODE; // index in tokens, NO_NODE when there is none
+    NodeIndex a = NO_NODE;
+    NodeIndex b = NO_NODE;
+  };
+
+  // list of node indices stored in the arena
+  struct NodeList {
+    const NodeIndex* first;
+    uint32_t count;
+
+    const NodeIndex* begin() const { return first; }
+    const NodeIndex* end() const { return first + count; }
+    uint32_t size() const { return count; }
+  };
+};
+
+class AstArena {
+public:
+  AstArena() {}
+
+  ast::NodeIndex add(ast::Kind kind, pToken token = nullptr, ast::NodeIndex a = ast::NO_NODE, ast::NodeIndex b = ast::NO_NODE);
+  ast::NodeIndex addNumber(pToken token, double value);
+  // list of children, gives the value for Node::a
+  ast::NodeIndex addList(const std::vector<ast::NodeIndex>& items);
+
+  // Adapter from the shared_ptr AST. Returns the index of the copied root.
+  ast::NodeIndex add(const pAstNode& node);
+
+  const ast::Node& node(ast::NodeIndex i) const { return nodes[i]; }
+  ast::Kind kind(ast::NodeIndex i) const { return nodes[i].kind; }
+  const pToken& token(ast::NodeIndex i) const { return tokens[nodes[i].token]; }
+  double number(ast::NodeIndex i) const { return numbers[nodes[i].a]; }
+  ast::NodeList list(ast::NodeIndex listIndex) const { return { &lists[listIndex + 1], lists[listIndex] }; }
+  size_t size() const { return nodes.size(); }
+  // bytes held by the arena
+  size_t bytes() const;
+  void clear();
+
+  // Calls the visitor member for the kind of node i with the arena and i.
+  template <typename Visitor>
+  auto visit(ast::NodeIndex i, Visitor& visitor) const;
+
+  // same output as AstNode::toString and AstNode::typeToString
+  std::string toString(ast::NodeIndex i) const;
+  std::string typeToString(ast::NodeIndex i, u_int in = 0) const;
+
+protected:
+  std::vector<ast::Node> nodes;
+  std::vector<ast::NodeIndex> lists;
+  std::vector<pToken> tokens;
+  std::vector<double> numbers;
+};
+
+template <typename Visitor>
+auto AstArena::visit(ast::NodeIndex i, Visitor& visitor) const {
+  switch (nodes[i].kind) {
+    case ast::Kind::PROGRAM:
+      return visitor.program(*this, i);
+    case ast::Kind::EXPRESSION_STATEMENT:
+      return visitor.expressionStatement(*this, i);
+    case ast::Kind::DECLARATION:
+      return visitor.declaration(*this, i);
+    case ast::Kind::ASSIGNMENT:
+      return visitor.assignment(*this, i);
+    case ast::Kind::NUMBER:
+      return visitor.number(*this, i);
+    case ast::Kind::PREFIX:
+      return visitor.prefix(*this, i);
+    case ast::Kind::INFIX:
+      return visitor.infix(*this, i);
+    case ast::Kind::CALL:
+      return visitor.call(*this, i);
+    case ast::Kind::IDENTIFIER:
+      return visitor.identifier(*this, i);
+    default:
+      return visitor.parameter(*this, i);
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "scan.h"
+
+// Block level pre-pass over a Markdown source. Every line is classified with
+// the CommonMark leaf block rules that matter for finding statements: ATX
+// headings, code fences, blank lines and the rest. Container blocks (lists,
+// block quotes) are not tracked, their lines are paragraphs like any other.
+namespace blocks {
+
+  enum class LineKind : uint8_t {
+    BLANK,     // only spaces and tabs
+    HEADING,   // 1-6 '#' followed by a space or the end of the line
+    FENCE,     // opening or closing ``` or ~~~
+    FENCED,    // inside a fenced code block, never holds statements
+    PARAGRAPH, // everything else
+  };
+
+  // lines that can hold statements
+  inline bool isCode(LineKind kind) {
+    return kind == LineKind::HEADING || kind == LineKind::PARAGRAPH;
+  }
+
+  struct LineMap {
+    std::vector<uint32_t> starts; // offset of the first byte of every line
+    std::vector<LineKind> kinds;
+    uint32_t end = 0;             // length of the source
+
+    size_t size() const { return starts.size(); }
+    // index of the line holding offset
+    size_t line(uint32_t offset) const;
+    // index of the first line starting after offset, size() if there is none
+    size_t lineAfter(uint32_t offset) const;
+    // Start of the first code line from the line holding offset onwards, or
+    // end when the rest of the source has no code. offset has to be a line start.
+    uint32_t nextCode(uint32_t offset) const;
+  };
+
+  // One linear sweep. Lines are split with the untilNewline kernel and only
+  // their first bytes are looked at, apart from fence lines.
+  LineMap classify(std::string_view src, const scan::Kernels& kernels = scan::best());
+};
@@ -1,11 +1,13 @@
 #pragma once
 #include <exception>
 #include <string>
+#include <vector>
+#include "sourceLocation.h"
 
 class SYNTAX_ERROR : public std::exception
 {
 public:
-  SYNTAX_ERROR(std::string description) : desc(description) {}
+  SYNTAX_ERROR(std::string description, unsigned int position = 0) : desc(description), pos(position) {}
 
   const char *what() const throw()
   {
@@ -13,8 +15,30 @@ public:
   }
 
   std::string desc = "unknown error";
+  unsigned int pos = 0; // byte offset in the source
 };
 
+// A problem found by the front end. Stages record these and go on from the
+// next line, so one compile reports every problem it finds.
+struct Diagnostic
+{
+  enum class Stage
+  {
+    LEXER,
+    PREPARSER,
+    PARSER
+  };
+
+  Stage stage;
+  std::string msg;
+  SourceLocation location = NO_LOCATION; // where the problem starts
+  // 1 based, filled in from the location by SourceManager::resolve
+  unsigned int line = 0;
+  unsigned int column = 0;
+};
+
+typedef std::vector<Diagnostic> Diagnostics;
+
 class PREFIX_MISSING : public std::exception
 {
 public:
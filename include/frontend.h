@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include "ast.h"
+#include "errors.h"
+#include "sourceManager.h"
+#include "syntaxTree.h"
+
+// Result of running the front end over one source.
+struct Compilation {
+  pAstProgram program;
+  // every problem found, in source order with line and column filled in
+  Diagnostics diagnostics;
+
+  bool ok() const {
+    return diagnostics.empty();
+  }
+};
+
+namespace frontend {
+  // Lexes, preparses and parses src. Statements with problems are left out of
+  // the program and reported in the diagnostics. Nothing is thrown, printed
+  // or exited on, so one process can compile any number of sources.
+  Compilation compile(std::string src);
+  // the same for a source added to sources, it is lexed in place without a copy
+  Compilation compile(const SourceManager& sources, FileId file);
+  // the same for the source a syntax tree holds, without lexing it again
+  Compilation compile(const SyntaxTree& tree);
+};
@@ -1,21 +1,117 @@
 #pragma once
+#include <array>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include "errors.h"
 #include "token.h"
+#include "tokenBuffer.h"
+#include "scan.h"
+#include "blocks.h"
+
+// Edit of a source: `removed` bytes at `offset` were replaced with `inserted`.
+struct SourceEdit {
+  u_int offset;
+  u_int removed;
+  std::string_view inserted;
+};
+
+// Tokens changed by an edit: `removed` old tokens starting from index `begin`
+// were replaced with `inserted` new ones.
+struct TokenEdit {
+  u_int begin;
+  u_int removed;
+  u_int inserted;
+};
 
 class Lexer
 {
 public:
   Lexer() {}
   Lexer(std::string src) : source(src) {}
+  // lex src without copying it. src has to outlive the lexer and its buffer.
+  // base is the location of its first byte, see SourceManager::location.
+  static Lexer borrow(std::string_view src, SourceLocation base = FIRST_LOCATION);
+
+  // both lex on several threads when the source is at least parallelThreshold bytes
   void generateTokens();
-  void addToken();
-  void addWordToken();
-  void addNumberToken();
+  void generateTokenBuffer();
+  void appendTokens(Tokens& out);
+  void appendTokenBuffer(TokenBuffer& out);
+  // Incremental re-lexing of the lines an edit touches. buffer has to be
+  // generated before, otherwise std::logic_error is thrown. edit applies the
+  // change to the owned source, relex borrows a source the caller has already
+  // edited. Heap tokens are spliced too when generateTokens made them, see
+  // tokensInStep. With recover, the diagnostics of the edited lines are
+  // dropped and the ones after them are moved. If the edited lines do not
+  // lex, SYNTAX_ERROR is thrown and the source, the buffer and the tokens are
+  // left as they were, after relex the caller still has to keep the old
+  // source. An edit that does not fit in the source throws std::out_of_range
+  // before anything is changed. With skipBlocks, an edit that changes the
+  // kind of the lines after it (opens or closes a fence) or turns its own
+  // line into code or out of it re-lexes the whole source.
+  TokenEdit edit(SourceEdit change);
+  TokenEdit relex(std::string_view edited, SourceEdit change);
+  // Pull api. Tokens are lexed on demand from pos and kept in a small ring
+  // buffer for lookahead: peek(0) is the token next() returns. After the end
+  // of the source both keep returning EndOfFile tokens.
+  pToken next();
+  pToken peek(u_int n = 0);
+  static const u_int lookahead = 16;
+
+  TokenType scanToken(u_int& start);
+  void scanWord();
+  TokenType scanNumber();
+  std::string_view text() const;
+  // hardware_concurrency, asked once. It reads from /sys and costs more than
+  // lexing a line.
+  static u_int hardwareThreads();
 
   std::string source = "";
+  // Tokens and diagnostics are located from base, the location of the first
+  // byte of the source.
+  SourceLocation base = FIRST_LOCATION;
   Tokens tokens;
+  TokenBuffer buffer;
   u_int pos = 0;
+  const scan::Kernels* kernels = &scan::best();
+  u_int threads = hardwareThreads();
+  u_int parallelThreshold = 1 << 20;
+  // Skip blank lines and fenced code blocks. Lines are classified once per
+  // generate (or on the first pull) into blockMap, see blocks.h.
+  bool skipBlocks = false;
+  std::shared_ptr<const blocks::LineMap> blockMap;
+  // With recover, generate and pull report text that does not lex in
+  // diagnostics and give an INVALID token for it instead of throwing
+  // SYNTAX_ERROR. Edited lines throw either way, unless the edit re-lexes
+  // the whole source.
+  bool recover = false;
+  Diagnostics diagnostics;
+
+protected:
+  pToken pull();
+  void prepareBlocks();
+  void checkEdit(SourceEdit change, size_t editedLength) const;
+  TokenEdit relexLines(SourceEdit change);
+  TokenEdit relexAll();
+  static bool sameKindsAfter(const blocks::LineMap& before, u_int oldEnd, const blocks::LineMap& after, u_int newEnd);
+  static bool sameCodeAt(const blocks::LineMap& before, u_int oldEnd, const blocks::LineMap& after, u_int newEnd);
+  TokenType fail(const char* msg, u_int at);
+  bool useThreads() const;
+  std::vector<u_int> chunkBounds() const;
+  template <typename Output>
+  std::vector<Output> lexChunks(std::vector<u_int> bounds);
+
+  std::string_view borrowed;
+  bool isBorrowed = false;
+  // tokens were made by generateTokens and have been kept in step with the
+  // buffer by every edit since
+  bool tokensInStep = false;
+  std::array<pToken, lookahead> ring;
+  u_int ringStart = 0;
+  u_int ringSize = 0;
 };
 
 bool isWordLetter(char c);
 bool isLetter(char c);
-bool isNumber(char c);
\ No newline at end of file
+bool isNumber(char c);
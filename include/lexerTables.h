@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "tokenType.h"
+
+// Lexer dispatch tables generated at compile time from tokenSpecs.
+namespace lexer {
+
+  enum class CharClass : uint8_t {
+    OTHER,    // lexed as a single UNDEFINED token
+    SPACE,
+    WORD,     // starts a word
+    NUMBER,   // starts a number
+    OPERATOR, // fixed lexeme, see CharEntry::type and pairs
+    UTF8,     // lead or continuation byte of a multibyte character
+  };
+
+  struct CharEntry {
+    CharClass charClass = CharClass::OTHER;
+    TokenType type = TokenType::UNDEFINED; // token of a single character operator
+  };
+
+  // two character lexeme starting with a given character
+  struct PairEntry {
+    int second = 0; // -1 marks a conflict
+    TokenType type = TokenType::UNDEFINED;
+    const char* error = nullptr; // pair is a syntax error instead of a token
+  };
+
+  // character pairs that are not tokens but errors
+  struct InvalidPair {
+    std::string_view lexeme;
+    const char* error;
+  };
+
+  constexpr InvalidPair invalidPairs[] = {
+    { "__", "Double underscore is not supported" },
+  };
+
+  constexpr std::array<CharEntry, 256> makeCharTable() {
+    std::array<CharEntry, 256> table = {};
+    for (int c = 'a'; c <= 'z'; ++c) {
+      table[c].charClass = CharClass::WORD;
+      table[c - 'a' + 'A'].charClass = CharClass::WORD;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+      table[c].charClass = CharClass::NUMBER;
+    }
+    table['.'].charClass = CharClass::NUMBER;
+    table[' '].charClass = CharClass::SPACE;
+    for (int c = 0x80; c < 256; ++c) {
+      table[c].charClass = CharClass::UTF8;
+    }
+
+    for (auto& spec : tokenSpecs) {
+      if (spec.lexeme.size() == 1) {
+        auto c = static_cast<unsigned char>(spec.lexeme[0]);
+        table[c].charClass = CharClass::OPERATOR;
+        table[c].type = spec.type;
+      }
+    }
+    return table;
+  }
+
+  // Every first character has at most one two character continuation. A
+  // conflicting spec would fail the static_assert below.
+  constexpr std::array<PairEntry, 256> makePairTable() {
+    std::array<PairEntry, 256> table = {};
+    for (auto& spec : tokenSpecs) {
+      if (spec.lexeme.size() == 2) {
+        auto& entry = table[static_cast<unsigned char>(spec.lexeme[0])];
+        entry.second = entry.second == 0 ? spec.lexeme[1] : -1;
+        entry.type = spec.type;
+      }
+    }
+    for (auto& pair : invalidPairs) {
+      auto& entry = table[static_cast<unsigned char>(pair.lexeme[0])];
+      entry.second = entry.second == 0 ? pair.lexeme[1] : -1;
+      entry.error = pair.error;
+    }
+    return table;
+  }
+
+  constexpr bool pairsAreUnambiguous(const std::array<PairEntry, 256>& table) {
+    for (auto& entry : table) {
+      if (entry.second == -1) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // pairs have to start with a single character operator
+  constexpr bool pairsStartWithOperator(const std::array<CharEntry, 256>& chars, const std::array<PairEntry, 256>& pairs) {
+    for (int c = 0; c < 256; ++c) {
+      if (pairs[c].second != 0 && chars[c].charClass != CharClass::OPERATOR) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr auto charTable = makeCharTable();
+  constexpr auto pairTable = makePairTable();
+
+  static_assert(pairsAreUnambiguous(pairTable), "two character lexemes must differ by their first character");
+  static_assert(pairsStartWithOperator(charTable, pairTable), "two character lexemes must start with an operator");
+};
@@ -2,28 +2,47 @@
 #include <memory>
 #include <iterator>
 #include "ast.h" 
+#include "errors.h"
 #include "token.h"
 #include "tokenType.h" 
+#include "processor.h"
+#include "pipeline.h"
+#include "threadPool.h"
+
+// built in statement processors, in the order they are tried
+typedef Pipeline<ExpressionStatementProc, DeclarationProc> StatementProcs;
 
 class Parser {
 public:
   Parser(pPreScope p = nullptr): pre(p) {}
   void parseScope();
   void parseStatement(pToken p);
-  pParserError verifyStatement(pToken t);
   pAstStatement createStatement(pToken t);
 
   pPreScope pre;
   pAstProgram scope = std::make_shared<AstProgram>();
-  Processors processors = {
-      std::make_shared<ExpressionStatementProc>(pre),
-      std::make_shared<DeclarationProc>(pre) };
+  // Resolved calls of this parse of pre. Each Parser has its own, so any
+  // number of them can parse one scope tree at once.
+  pCallMemo calls = std::make_shared<CallMemo>();
+  StatementProcs statements = StatementProcs(ExpressionStatementProc(pre, calls), DeclarationProc(pre, calls));
+  // Processors registered at runtime. When there are any they are tried
+  // instead of the built in ones, through virtual calls. They hold their
+  // scope, so nested scopes are parsed with the built in ones.
+  Processors processors;
+  // Problems found in this scope and the scopes in it. A statement with a
+  // problem is left out of the program and parsing goes on.
+  Diagnostics diagnostics;
+  // When set, the scopes of declarations are parsed as tasks on it. The
+  // program and the diagnostics are the same either way.
+  ThreadPool* pool = nullptr;
 
 protected:
+  template <typename P>
+  pAstStatement parseWith(P& processor, pToken t);
+  void report(pToken t, std::string msg);
+  void joinDiagnostics(const std::vector<std::unique_ptr<Parser>>& nested, const std::vector<size_t>& nestedAt);
+
   pParserError newPError(std::string msg) {
     return std::make_shared<ParserError>(msg);
   }
-
-  Tokens::iterator cur;
-  Tokens::iterator prev;
 };
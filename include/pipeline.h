@@ -0,0 +1,39 @@
+#pragma once
+#include <tuple>
+#include <utility>
+
+// Processors known at compile time, held by value and tried in order.
+// Calls go straight to the concrete types, so with final processor classes
+// there is no virtual dispatch and no allocation per statement.
+template <typename... Processors>
+class Pipeline {
+public:
+  Pipeline() = default;
+  Pipeline(Processors... p): processors(std::move(p)...) {}
+
+  // Calls run with the first processor that accepts. Returns false when
+  // none does.
+  template <typename Accepts, typename Run>
+  bool first(Accepts&& accepts, Run&& run) {
+    return std::apply([&](auto&... processor) {
+      return (tryProcessor(processor, accepts, run) || ...);
+    }, processors);
+  }
+
+  template <typename F>
+  void each(F&& f) {
+    std::apply([&](auto&... processor) { (f(processor), ...); }, processors);
+  }
+
+  std::tuple<Processors...> processors;
+
+private:
+  template <typename P, typename Accepts, typename Run>
+  static bool tryProcessor(P& processor, Accepts& accepts, Run& run) {
+    if (!accepts(processor)) {
+      return false;
+    }
+    run(processor);
+    return true;
+  }
+};
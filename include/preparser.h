@@ -1,30 +1,61 @@
 #pragma once
+#include "errors.h"
 #include "token.h"
+#include "tokenBuffer.h"
+#include "lexer.h"
 #include "ast.h"
 #include "preprocessor.h"
 #include "scopeBuilder.h"
+#include "pipeline.h"
 #include <iterator>
 
 class PreParser;
 
+// built in statement processors, in the order they are tried
+typedef Pipeline<DefinitionProcessor, AssignmentProcessor, ExpressionStatementProcessor> StatementProcessors;
+
 class PreParser {
 public:
     PreParser(Tokens t = {}): tokens(t), parsedTokens({}), scoped(nullptr) {
-        processors.push_back(std::make_shared<DefinitionProcessor>());
-        processors.push_back(std::make_shared<AssignmentProcessor>());
-        processors.push_back(std::make_shared<ExpressionStatementProcessor>());
+        // processors stop on END tokens, the last one has to be there
+        if (tokens.empty() || !tokens.back()->isTypeOf(TokenType::END_OF_FILE)) {
+            tokens.push_back(std::make_shared<Token>(TokenType::END_OF_FILE));
+        }
+        statements.each([this](PreProcessor& processor) {
+            processor.arena = arena.get();
+        });
     }
+    PreParser(const TokenBuffer& buffer): PreParser(buffer.toTokens()) {}
 
     void prepareFromStart();
+    void prepareFromLexer(Lexer& lexer);
     void prepare(Tokens::iterator it);
     void prepareStatements(Tokens::iterator& it);
-    void flattenDeclarations();
-    void prepareScopeTree(Tokens::iterator it);
-    void gatherIdentifiers();
-    void gatherIdentifiersForScope(pPreScope scope);
+    void prepareStatement(LineInfo& line);
+    void addStatement(pToken statement);
+    void addProcessor(std::shared_ptr<PreProcessor> processor);
 
     Tokens tokens;
+    // Every pre token of the compilation. It lives as long as any copy of
+    // this PreParser, and the scope graph has to be used within that time.
+    std::shared_ptr<PreArena> arena = std::make_shared<PreArena>();
+    // every statement in source order, with the block each declaration opens
     Tokens parsedTokens;
     pPreScope scoped;
+    StatementProcessors statements;
+    // Processors registered at runtime with addProcessor. When there are any
+    // they are tried instead of the built in ones, through virtual calls.
     std::vector<std::shared_ptr<PreProcessor>> processors;
+    // Problems found so far. A line with a problem is left out and
+    // preparing goes on from the next line.
+    Diagnostics diagnostics;
+
+protected:
+    void openRoot();
+    template <typename P>
+    bool prepareWith(P& processor, Tokens::iterator& it);
+    void report(std::string msg);
+
+    ScopeBuilder builder;
+    SourceLocation statementAt = NO_LOCATION; // of the statement being prepared
 };
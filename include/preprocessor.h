@@ -3,18 +3,44 @@
 
 class PreProcessorError;
 
+// One line of the token vector, classified by a single scan so that the
+// processor for a statement is chosen without rescanning the line.
+struct LineInfo {
+    static constexpr u_int NONE = UINT32_MAX;
+
+    u_int start = 0;     // first token of the line
+    u_int end = 0;       // the END token closing the line
+    u_int depth = 0;     // leading hashes
+    u_int equals = NONE; // first EQUALS
+    bool import = false; // starts with [...]( like an import
+    u_int invalid = NONE; // first INVALID token, the lexer has reported it
+};
+
+typedef std::vector<LineInfo> LineTable;
+
 class PreProcessor {
 public:
     virtual bool check(Tokens& t, Tokens::iterator it) = 0;                                // check if this processor is the case for group of Tokens
-    virtual std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it) = 0; // verify that statement is semantically sound
-    virtual std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it) = 0;         // create a pre processed node that can be handled in parser
-    size_t getLineLength() { return line.size(); }
+    virtual bool check(Tokens& t, const LineInfo& line) { return check(t, t.begin() + line.start); } // same for a line starting a statement
+    // Walks the statement once, building a pre processed node that can be
+    // handled in parser. Sets error on the first problem and returns nullptr
+    // then. Processors for parts of a statement are run through their parse.
+    virtual std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) = 0;
 
-    u_int endPosition;
+    PreArena* arena = nullptr; // where parse makes pre tokens, the heap when null
 
 protected:
-    bool separateLine(Tokens& t, Tokens::iterator& begin, std::vector<TokenType> end = token::END); // separate line from the whole source
-    Tokens line;                                                                                    // convenient cache for line specific statements
+    template <typename T>
+    std::shared_ptr<T> make() {
+        return arena != nullptr ? arena->make<T>() : std::make_shared<T>();
+    }
+
+    // processor for a part of the statement, making into the same arena
+    template <typename P>
+    P part(P processor) {
+        processor.arena = arena;
+        return processor;
+    }
 };
 
 class ComponentProcessor: public PreProcessor {
@@ -22,82 +48,72 @@ public:
     TokenTypes endsWith = token::END;
 };
 
-class DefinitionProcessor: public PreProcessor {
+class DefinitionProcessor final: public PreProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    bool check(Tokens& t, const LineInfo& line) override;
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
-class AssignmentProcessor: public PreProcessor {
+class AssignmentProcessor final: public PreProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    bool check(Tokens& t, const LineInfo& line) override;
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
-class ImportProcessor: public PreProcessor {
+class ImportProcessor final: public PreProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    bool check(Tokens& t, const LineInfo& line) override;
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
-class ExpressionStatementProcessor: public PreProcessor {
+class ExpressionStatementProcessor final: public PreProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    bool check(Tokens& t, const LineInfo& line) override;
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
-class ExpressionProcessor: public ComponentProcessor {
+class ExpressionProcessor final: public ComponentProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
-
-    TokenTypes legalTokens = { TokenType::EQUALS_COMPARE, TokenType::WORD,
-                         TokenType::PLUS, TokenType::MINUS,
-                         TokenType::SLASH, TokenType::ASTERISK,
-                         TokenType::COLON, TokenType::BANG,
-                         TokenType::LBRACE, TokenType::RBRACE,
-                         TokenType::LBRACKET, TokenType::RBRACKET,
-                         TokenType::GT, TokenType::GT_OR_EQUALS,
-                         TokenType::LT, TokenType::LT_OR_EQUALS,
-                         TokenType::NOT_EQUALS, TokenType::NUMBER,
-                         TokenType::WORD, TokenType::UNDERSCORE, };
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
+
+    static constexpr TokenTypes expressionTokens = { TokenType::EQUALS_COMPARE, TokenType::WORD,
+                                                     TokenType::PLUS, TokenType::MINUS,
+                                                     TokenType::SLASH, TokenType::ASTERISK,
+                                                     TokenType::COLON, TokenType::BANG,
+                                                     TokenType::LBRACE, TokenType::RBRACE,
+                                                     TokenType::LBRACKET, TokenType::RBRACKET,
+                                                     TokenType::GT, TokenType::GT_OR_EQUALS,
+                                                     TokenType::LT, TokenType::LT_OR_EQUALS,
+                                                     TokenType::NOT_EQUALS, TokenType::NUMBER,
+                                                     TokenType::WORD, TokenType::UNDERSCORE, };
+    TokenTypes legalTokens = expressionTokens;
 };
 
 class ParameterProcessor: public PreProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
 protected:
-    std::shared_ptr<PreProcessorError> verifyParameter(Tokens& t, Tokens::iterator& it);
-    std::shared_ptr<PreToken> createParameter(Tokens& t, Tokens::iterator& it, std::shared_ptr<ComponentProcessor> cp);
+    // cp has to end on UNDERSCORE and END
+    std::shared_ptr<PreToken> parseParameter(Tokens& t, Tokens::iterator& it, ComponentProcessor& cp, std::shared_ptr<PreProcessorError>& error);
 };
 
 class IdentifierProcessor: public ComponentProcessor {
 public:
     bool check(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
     void setEndsWith(TokenTypes tt) {
         endsWith = tt;
     }
 
-    TokenTypes endsWith = {
-        TokenType::PLUS, TokenType::MINUS,
-        TokenType::SLASH, TokenType::ASTERISK,
-        TokenType::END_OF_FILE, TokenType::ENDL,
-        TokenType::BANG,
-        TokenType::GT, TokenType::GT_OR_EQUALS,
-        TokenType::LT, TokenType::LT_OR_EQUALS,
-        TokenType::EQUALS_COMPARE, TokenType::NOT_EQUALS,
-    };
+    TokenTypes endsWith = token::INFIX | token::END | TokenType::BANG;
 
 protected:
-    virtual std::shared_ptr<PreProcessorError> verifyIdentifier(Tokens& t, Tokens::iterator it, std::shared_ptr<ParameterProcessor> pp);
-    virtual std::shared_ptr<PreToken> createIdentifier(Tokens& t, Tokens::iterator& it, std::shared_ptr<ParameterProcessor> pp);
+    std::shared_ptr<PreToken> parseIdentifier(Tokens& t, Tokens::iterator& it, ParameterProcessor& pp, std::shared_ptr<PreProcessorError>& error);
 };
 
 class DeclarationIdentifierProcessor: public IdentifierProcessor {
@@ -105,21 +121,18 @@ public:
     DeclarationIdentifierProcessor(): IdentifierProcessor() {
         setEndsWith(token::END);
     }
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it) override;
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it) override;
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
 
-class ActualParameterProcessor: public ParameterProcessor {
+class ActualParameterProcessor final: public ParameterProcessor {
 public:
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
-class FormalParameterProcessor: public ParameterProcessor {
+class FormalParameterProcessor final: public ParameterProcessor {
 public:
-    std::shared_ptr<PreProcessorError> verify(Tokens& t, Tokens::iterator it);
-    std::shared_ptr<PreToken> create(Tokens& t, Tokens::iterator& it);
+    std::shared_ptr<PreToken> parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) override;
 };
 
 class PreProcessorError {
@@ -135,32 +148,46 @@ namespace preprocessor {
         return std::make_shared<PreProcessorError>(msg);
     }
 
-    inline bool expect(Tokens::iterator& it, std::vector<TokenType> expectedTypes) {
-        it = std::next(it);
+    // classifies the line starting at start
+    LineInfo classifyLine(const Tokens& t, u_int start);
+    // classifies every line from start to the end of file
+    LineTable lineTable(const Tokens& t, u_int start);
+
+    // Scanning helpers are templated on the iterator so that they work both on
+    // heap Tokens and directly on a TokenBuffer. They stop on an END token and
+    // never move past end, where the -1 and false results mean the same.
+
+    template <typename Iterator>
+    inline bool expect(Iterator& it, Iterator end, const TokenTypes& expectedTypes) {
+        if (it == end || ++it == end) {
+            return false;
+        }
         return (*it)->isTypeOf(expectedTypes);
     }
 
-    inline int expectMultiple(Tokens::iterator& it, std::vector<TokenType> expectedTokens) {
+    template <typename Iterator>
+    inline int expectMultiple(Iterator& it, Iterator end, const TokenTypes& expectedTokens) {
         int count = 0;
-        while ((*it)->isTypeOf(expectedTokens)) {
+        while (it != end && (*it)->isTypeOf(expectedTokens)) {
             if ((*it)->isTypeOf(token::END)) {
                 return -1;
             }
             ++count;
-            it = std::next(it);
+            ++it;
         }
-        return count;
+        return it == end ? -1 : count;
     }
 
-    inline int fastForwardUntil(Tokens::iterator& it, std::vector<TokenType> expectedTokens) {
+    template <typename Iterator>
+    inline int fastForwardUntil(Iterator& it, Iterator end, const TokenTypes& expectedTokens) {
         int count = 0;
-        while (!(*it)->isTypeOf(expectedTokens)) {
+        while (it != end && !(*it)->isTypeOf(expectedTokens)) {
             if ((*it)->isTypeOf(token::END)) {
                 return -1;
             }
             ++count;
-            it = std::next(it);
+            ++it;
         }
-        return count;
+        return it == end ? -1 : count;
     }
 };
\ No newline at end of file
@@ -4,28 +4,6 @@
 #include "token.h"
 #include "ast.h"
 
-enum class ExprOrder {
-  LOWEST = 0,
-  EQUALS,
-  LESSGREATER,
-  SUM,
-  PPRODUCT,
-  PREFIX
-};
-
-static std::unordered_map<TokenType, ExprOrder> precedences = {
-    {TokenType::EQUALS_COMPARE, ExprOrder::EQUALS},
-    {TokenType::NOT_EQUALS, ExprOrder::EQUALS},
-    {TokenType::LT, ExprOrder::LESSGREATER},
-    {TokenType::GT, ExprOrder::LESSGREATER},
-    {TokenType::LT_OR_EQUALS, ExprOrder::LESSGREATER},
-    {TokenType::GT_OR_EQUALS, ExprOrder::LESSGREATER},
-    {TokenType::PLUS, ExprOrder::SUM},
-    {TokenType::MINUS, ExprOrder::SUM},
-    {TokenType::SLASH, ExprOrder::PPRODUCT},
-    {TokenType::ASTERISK, ExprOrder::PPRODUCT},
-};
-
 struct ParserError {
   ParserError(std::string _msg): msg(_msg) {}
 
@@ -34,14 +12,20 @@ struct ParserError {
 
 typedef std::shared_ptr<ParserError> pParserError;
 
+// Calls made from one scope by phrase shape, with what they resolved to. It
+// belongs to one parse of the scope, the pre scope tree is only read.
+typedef std::unordered_map<uint64_t, PreIdentifiers> CallMemo;
+typedef std::shared_ptr<CallMemo> pCallMemo;
+
 class Processor {
 public:
-  Processor(TokenTypes _type, pPreScope _scope): type(_type), scope(_scope) {}
+  Processor(TokenTypes _type, pPreScope _scope, pCallMemo _calls): type(_type), scope(_scope), calls(_calls) {}
   virtual bool check(pToken t) {
     return t->isTypeOf(type);
   }
-  virtual pParserError verify(pToken t) = 0;
-  virtual pAstNode create(pToken t) = 0;
+  // Builds the node in a single pass and sets error on the first problem,
+  // nullptr is returned then. Processors nest by calling each other's parse.
+  virtual pAstNode parse(pToken t, pParserError& error) = 0;
 
 protected:
   pParserError newPError(std::string msg) {
@@ -50,47 +34,41 @@ protected:
 
   TokenTypes type;
   pPreScope scope;
+  pCallMemo calls; // shared with the processors this one makes
 };
 
 typedef std::shared_ptr<Processor> pProcessor;
 typedef std::vector<pProcessor> Processors;
 
-class ExpressionStatementProc: public Processor {
+class ExpressionStatementProc final: public Processor {
 public:
-  ExpressionStatementProc(pPreScope scope): Processor({ TokenType::EXPRESSION_STATEMENT }, scope) {}
-  pParserError verify(pToken t);
-  pAstNode create(pToken t);
+  ExpressionStatementProc(pPreScope scope, pCallMemo calls = std::make_shared<CallMemo>()): Processor({ TokenType::EXPRESSION_STATEMENT }, scope, calls) {}
+  pAstNode parse(pToken t, pParserError& error) override;
 
 };
 
-class DeclarationProc: public Processor {
+class DeclarationProc final: public Processor {
 public:
-  DeclarationProc(pPreScope scope): Processor({ TokenType::DECLARE }, scope) {}
-  pParserError verify(pToken t);
-  pAstNode create(pToken t);
+  DeclarationProc(pPreScope scope, pCallMemo calls = std::make_shared<CallMemo>()): Processor({ TokenType::DECLARE }, scope, calls) {}
+  pAstNode parse(pToken t, pParserError& error) override;
 };
 
-class ExpressionProc: public Processor {
+class ExpressionProc final: public Processor {
 public:
-  ExpressionProc(pPreScope scope): Processor({ TokenType::EXPRESSION }, scope) {}
-  pParserError verify(pToken t);
-  pAstNode create(pToken t);
+  ExpressionProc(pPreScope scope, pCallMemo calls = std::make_shared<CallMemo>()): Processor({ TokenType::EXPRESSION }, scope, calls) {}
+  pAstNode parse(pToken t, pParserError& error) override;
 
-  pParserError verifyTokens(Tokens t);
   std::shared_ptr<AstExpression> parseExpression(ExprOrder precedence);
   std::shared_ptr<AstExpression> parseNumberLiteral();
   std::shared_ptr<AstExpression> parsePrefixExpression();
   std::shared_ptr<AstExpression> parseInfixExpression(std::shared_ptr<AstExpression> leftExp);
 
-  Tokens src;
-  Tokens::iterator cur;
+  TokenSpan src;
+  TokenSpan::iterator cur;
+  pParserError error; // first problem found by parseExpression
 
-  TokenTypes prefixTypes = { TokenType::IMPORT, TokenType::BANG, TokenType::NUMBER, TokenType::MINUS, TokenType::CALL };
-  TokenTypes infixTypes = { TokenType::PLUS, TokenType::MINUS,
-    TokenType::ASTERISK, TokenType::SLASH,
-    TokenType::EQUALS_COMPARE, TokenType::NOT_EQUALS,
-    TokenType::GT, TokenType::GT_OR_EQUALS,
-    TokenType::LT, TokenType::LT_OR_EQUALS };
+  TokenTypes prefixTypes = token::PREFIX;
+  TokenTypes infixTypes = token::INFIX;
   TokenTypes callTypes = { TokenType::IDENTIFIER };
 
   void next() {
@@ -100,49 +78,47 @@ public:
     return;
   }
 
+  // binding power of the token after cur, LOWEST at the end or when it is
+  // not an infix operator
   ExprOrder peekPrecedence() {
     if (cur == src.end() || (cur + 1) == src.end()) {
       return ExprOrder::LOWEST;
     }
+    return tokenTraits((*(cur + 1))->type).precedence;
+  }
 
-    try {
-      return precedences.at((*(cur + 1))->type);
-    } catch (std::out_of_range& e) {
-      std::cerr << "Expression: Could not find precedence type for " << (*cur)->literal
-        << "(" << (*cur)->typeToString() << ")\n";
-      return ExprOrder::LOWEST;
+  std::shared_ptr<AstExpression> fail(std::string msg) {
+    if (error == nullptr) {
+      error = newPError(msg);
     }
-
+    return nullptr;
   }
 
   ExprOrder curPrecedence() {
-    try {
-      return precedences.at((*cur)->type);
-    } catch (std::out_of_range& e) {
-      return ExprOrder::LOWEST;
-    }
+    return tokenTraits((*cur)->type).precedence;
   }
 };
 
-class IdentifierProc: public Processor {
+class IdentifierProc final: public Processor {
 public:
-  IdentifierProc(pPreScope scope): Processor({ TokenType::IDENTIFIER }, scope) {}
-  pParserError verify(pToken t);
-  pAstNode create(pToken t);
+  IdentifierProc(pPreScope scope, pCallMemo calls = std::make_shared<CallMemo>()): Processor({ TokenType::IDENTIFIER }, scope, calls) {}
+  pAstNode parse(pToken t, pParserError& error) override;
 };
 
 class CallProc {
 public:
-  CallProc(pPreScope _scope): scope(_scope) {}
+  CallProc(pPreScope _scope, pCallMemo _calls = std::make_shared<CallMemo>()): scope(_scope), calls(_calls) {}
   // important! Use checkLine instead of basic check. 
   // Identifier check needs the whole line rather than single token.
   // checkLine returns 0 if identifier not found 
-  std::shared_ptr<PreIdentifier> checkLine(Tokens tokens, Tokens::iterator it);
-  std::shared_ptr<AstCall> create(Tokens tokens, Tokens::iterator& it);
+  // Nothing is copied while resolving, the first call of each phrase is
+  // remembered in calls.
+  std::shared_ptr<PreIdentifier> checkLine(TokenSpan tokens, TokenSpan::iterator it);
 
-  std::shared_ptr<PreIdentifier> checkIdentifiersForLinePerScope(Tokens tokens, Tokens::iterator it, pPreScope s);
-  std::shared_ptr<PreIdentifier> checkIdentifier(Tokens tokens, Tokens::iterator it, pPreIdentifier t);
+  std::shared_ptr<PreIdentifier> checkIdentifiersForLinePerScope(TokenSpan tokens, TokenSpan::iterator it, PreScope* s);
+  std::shared_ptr<PreIdentifier> checkIdentifier(TokenSpan tokens, TokenSpan::iterator it, const pPreIdentifier& t);
 
   pPreScope scope;
+  pCallMemo calls;
 };
 
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+
+// Character run scanning kernels used by the Lexer. Every kernel returns the
+// length of the run that starts from p, or n if the run reaches the end.
+// Vector versions classify 16 (SSE2) or 32 (AVX2) bytes at a time and the best
+// one supported by the cpu is picked at runtime.
+namespace scan {
+
+  // Byte classes of the kernels. The scalar kernels, the tails of the vector
+  // kernels, the ASCII part of the UTF-8 word path and the Lexer helpers all
+  // use these, so they cannot disagree.
+  constexpr bool isLetterByte(unsigned char c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+  }
+
+  constexpr bool isNumberByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || c == '.';
+  }
+
+  constexpr bool isWordByte(unsigned char c) {
+    return isLetterByte(c) || isNumberByte(c) || c == '-';
+  }
+
+  struct Kernels {
+    const char* name;
+    size_t (*wordRun)(const char* p, size_t n);   // [a-zA-Z0-9.-]
+    size_t (*numberRun)(const char* p, size_t n); // [0-9.]
+    size_t (*spaceRun)(const char* p, size_t n);  // ' '
+    size_t (*untilNewline)(const char* p, size_t n); // bytes before the next '\n'
+  };
+
+  const Kernels& scalar();
+  const Kernels& sse2();
+  const Kernels& avx2();
+
+  // best kernels supported by the running cpu
+  const Kernels& best();
+
+  bool hasSse2();
+  bool hasAvx2();
+};
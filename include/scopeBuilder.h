@@ -1,12 +1,22 @@
 #pragma once
 #include "token.h"
 
+// Builds the scope tree and the identifier tables of its scopes while pre
+// tokens arrive in source order. A declaration opens a scope at its depth,
+// which holds everything after it until a shallower declaration. A
+// declaration of the same depth is nested in it, so `# a`, `# b` is a chain
+// of scopes, not two siblings. Its name still belongs to the first scope
+// that is shallower than it.
 class ScopeBuilder
 {
 public:
-  ScopeBuilder() {}
-  void build(Tokens &_tokens);
+  ScopeBuilder(PreArena* a = nullptr): arena(a) {}
+  void open(u_int depth);
+  // false when a declaration or assignment has no identifier to add
+  bool add(pToken t);
+  void closeDeeperThan(u_int depth);
 
+  PreArena* arena;
   pPreScope root;
   pPreScope current;
-};
\ No newline at end of file
+};
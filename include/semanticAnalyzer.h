@@ -35,21 +35,21 @@ protected:
   void createLink();
   void createDeclaration();
   void createAssignment();
-  void createIdentifier(std::shared_ptr<Token> partOf, std::vector<TokenType> end);
+  void createIdentifier(std::shared_ptr<Token> partOf, TokenTypes end);
   void createParameter(std::shared_ptr<Token> identifier);
-  void createExpression(std::shared_ptr<Token> partOf, std::vector<TokenType> end);
+  void createExpression(std::shared_ptr<Token> partOf, TokenTypes end);
   void createArgument(
       std::shared_ptr<Token> callToken,
-      std::shared_ptr<Token> paramToken,
-      std::shared_ptr<Token> endToken);
+      Token* paramToken,
+      Token* endToken);
   void searchIdentifier();
   std::string searchKeyPhrase();
   std::vector<Tokens> gatherKeyPhraseArgs(std::string keyPhraseName);
   void addKeyPhrase(std::string keyPhraseName, std::vector<Tokens> args);
-  void omitTokens(std::vector<TokenType> types);
-  void rewindIterator(std::vector<TokenType> types);
+  void omitTokens(TokenTypes types);
+  void rewindIterator(TokenTypes types);
   void removeLastAnalyzedLine();
-  int findLastAnalyzedTokenIndex(std::vector<TokenType> types);
+  int findLastAnalyzedTokenIndex(TokenTypes types);
 
 private:
   Tokens::iterator srcIt;
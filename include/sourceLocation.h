@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+// Position in the sources of a SourceManager, see sourceManager.h. Every
+// source gets a range of locations of its own, so 32 bits name both the
+// source and the byte in it.
+typedef uint32_t SourceLocation;
+constexpr SourceLocation NO_LOCATION = 0;
+// location of the first byte of the first source, and of a lexer that is
+// not given one
+constexpr SourceLocation FIRST_LOCATION = 1;
@@ -0,0 +1,70 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+#include "errors.h"
+#include "sourceLocation.h"
+
+typedef uint32_t FileId;
+
+// 1 based line and column (in bytes) of a location
+struct SourcePosition {
+  std::string_view file;
+  u_int line = 0;
+  u_int column = 0;
+};
+
+// Owner of the sources of a compilation. Files are mapped read only instead
+// of read into strings, and the lexer borrows the mapped text. Locations are
+// given out in one range per source, in the order sources are added, so a
+// location sorts by source and then by offset. Line starts of a source are
+// indexed on the first position asked for in it, and a position is two
+// binary searches from there.
+// open and add are not thread safe, everything else is.
+class SourceManager {
+public:
+  SourceManager() {}
+  SourceManager(const SourceManager&) = delete;
+  SourceManager& operator=(const SourceManager&) = delete;
+  ~SourceManager();
+
+  // Maps the file at path. Throws std::system_error when it cannot be read.
+  FileId open(const std::string& path);
+  // source that is not read from a file, the text is kept by the manager
+  FileId add(std::string name, std::string text);
+
+  std::string_view text(FileId file) const { return files[file]->text; }
+  std::string_view name(FileId file) const { return files[file]->name; }
+  // location of the byte at offset, offset may be the size of the source
+  SourceLocation location(FileId file, u_int offset = 0) const { return files[file]->base + offset; }
+  size_t size() const { return files.size(); }
+
+  // Both throw std::out_of_range for NO_LOCATION and locations that were
+  // not given out.
+  FileId fileOf(SourceLocation location) const;
+  SourcePosition position(SourceLocation location) const;
+  // fills in line and column of the diagnostics that have a location
+  void resolve(Diagnostics& diagnostics) const;
+
+protected:
+  struct File {
+    std::string name;
+    std::string_view text;
+    SourceLocation base;
+    void* mapped = nullptr; // the mapping when text is a mapped file
+    std::string owned; // the text when it is not
+    mutable std::once_flag indexed;
+    mutable std::vector<u_int> lineStarts;
+  };
+
+  FileId addFile(std::unique_ptr<File> file);
+  const std::vector<u_int>& lineStarts(const File& file) const;
+
+  // File is not movable because of the once_flag
+  std::vector<std::unique_ptr<File>> files;
+  std::vector<SourceLocation> bases; // of files, for the binary search
+  SourceLocation next = FIRST_LOCATION;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Interned word literal. 0 is reserved for "no symbol".
+typedef uint32_t Symbol;
+
+// Thread safe string interner. Equal strings get equal symbols, so word
+// comparisons are integer compares. Interned strings are never freed and the
+// views handed out stay valid for the lifetime of the table. Symbols of
+// tables of different generations are not comparable.
+class SymbolTable {
+public:
+  SymbolTable(uint32_t g = 0): generation(g) {}
+  SymbolTable(const SymbolTable&) = delete;
+  SymbolTable& operator=(const SymbolTable&) = delete;
+
+  Symbol intern(std::string_view text);
+  Symbol find(std::string_view text) const; // 0 when text is not interned
+  std::string_view view(Symbol symbol) const;
+  size_t size() const;
+
+  const uint32_t generation;
+
+protected:
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string_view, Symbol> ids;
+  std::deque<std::string> strings; // deque keeps the strings in place when it grows
+};
+
+typedef std::shared_ptr<SymbolTable> pSymbolTable;
+
+namespace symbols {
+  // The process wide table new words are interned into. Every reset() puts
+  // a table of the next generation in its place.
+  pSymbolTable current();
+
+  // Interns into the current table through a lock free per thread cache and
+  // sets generation to the one of that table. The cache holds the recent
+  // words of the thread, not the whole table.
+  Symbol intern(std::string_view text, uint32_t& generation);
+  // the same for a table that is not the current one any more
+  Symbol intern(const pSymbolTable& table, std::string_view text);
+
+  // Starts a new generation, for long running hosts that do not want the
+  // table to grow forever. Safe while other threads intern: they go on with
+  // the table they hold until their next word, and a table is freed when
+  // the last holder lets it go. Tokens keep the generation of their symbol
+  // and compare their literals with tokens of other generations.
+  void reset();
+
+  // view of a symbol of the current generation
+  inline std::string_view view(Symbol symbol) {
+    return current()->view(symbol);
+  }
+};
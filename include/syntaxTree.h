@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "errors.h"
+#include "lexer.h"
+#include "token.h"
+
+// Lossless concrete syntax tree, kept between versions of a source for
+// editors and watchers. Green nodes are immutable and know their width but
+// not where they are, so the tree after an edit shares every node the edit
+// does not touch with the tree before it. Only the re-lexed lines and the
+// groups on their path to the root are new. Positions are worked out on the
+// way down, see SyntaxLine.
+// Statements never span a line, so lines are the leaves and the unit that
+// is lexed again. They are grouped into a balanced tree with at most
+// MAX_CHILDREN children per group. Tokens keep the spaces in front of them,
+// so the text of the tree is the source byte for byte, and text that does
+// not lex is kept as INVALID tokens.
+namespace syntax {
+
+  enum class Kind : uint8_t {
+    GROUP,
+    LINE,
+  };
+
+  struct GreenToken {
+    TokenType type;
+    u_int trivia; // spaces in front of the token, they start its text
+    std::string text;
+  };
+
+  struct GreenNode;
+  typedef std::shared_ptr<const GreenNode> pGreenNode;
+  typedef std::vector<pGreenNode> GreenNodes;
+
+  struct GreenNode {
+    Kind kind;
+    u_int height = 0; // 0 for lines, the children of a group are one lower
+    u_int width = 0;  // in bytes
+    u_int lines = 0;
+    GreenNodes children; // of a group
+    // Of a line, ending with ENDL or on the last line with END_OF_FILE.
+    std::vector<GreenToken> tokens;
+    // Of a line, reported by the lexer and located as if the line started
+    // at FIRST_LOCATION.
+    Diagnostics problems;
+  };
+
+  constexpr u_int MAX_CHILDREN = 32;
+};
+
+// A line of a SyntaxTree with its position in that tree.
+struct SyntaxLine {
+  const syntax::GreenNode* green;
+  u_int index;
+  u_int offset;
+};
+
+class SyntaxTree {
+public:
+  SyntaxTree() {}
+
+  // lexes src with recovery, the tree keeps no reference to src
+  static SyntaxTree parse(std::string_view src);
+
+  // The tree after change. Only the lines the edit touches are lexed again.
+  // This tree stays as it was and shares the rest of its nodes.
+  SyntaxTree edit(SourceEdit change) const;
+
+  u_int width() const { return root->width; }
+  u_int lineCount() const { return root->lines; }
+  SyntaxLine line(u_int index) const;
+  // the line holding the byte at offset, the last line for the end
+  SyntaxLine lineAt(u_int offset) const;
+  std::string text() const;
+
+  // The tokens and problems lexing text() with recovery would give, located
+  // from base. PreParser(tree.tokens()) gives the PreScope view and
+  // frontend::compile(tree) the AstProgram.
+  Tokens tokens(SourceLocation base = FIRST_LOCATION) const;
+  Diagnostics diagnostics(SourceLocation base = FIRST_LOCATION) const;
+
+  syntax::pGreenNode root;
+};
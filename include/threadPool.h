@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Work stealing pool. Every worker has a deque of its own: tasks started
+// from a worker go to its back and it takes them back from there, idle
+// workers steal from the front of the others. wait() runs tasks while the
+// group is not done, so tasks can start and wait for tasks of their own.
+// When there is nothing left to run it sleeps until the group is done or
+// gets a new task.
+class ThreadPool {
+public:
+  // tasks that are waited for together
+  class Group {
+  public:
+    Group() {}
+    Group(const Group&) = delete;
+
+  private:
+    friend class ThreadPool;
+    // changed under mutex, read without it while running tasks
+    std::atomic<u_int> pending = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::exception_ptr error; // the first a task threw
+  };
+
+  ThreadPool(u_int threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  void run(Group& group, std::function<void()> task);
+  // Returns once every task of group has run. When tasks threw, the first
+  // exception is thrown from here after the rest of the group is done.
+  void wait(Group& group);
+  u_int size() const { return workers.size(); }
+
+protected:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(u_int index);
+  // runs one task, from queue index first, false when there was none
+  bool runOne(u_int index);
+  u_int ownQueue() const;
+  static void finish(Group& group, std::exception_ptr error);
+
+  // one queue per worker and the last one for threads outside the pool
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<u_int> queued = 0;
+  std::mutex sleep;
+  std::condition_variable wake;
+  bool stop = false;
+};
@@ -1,53 +1,93 @@
 #pragma once
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include "tokenType.h"
+#include "symbols.h"
+#include "sourceLocation.h"
 
 class Token;
 typedef std::vector<std::shared_ptr<Token>> Tokens;
 typedef std::shared_ptr<Token> pToken;
 
+// Non-owning view of consecutive tokens. Token vectors from the lexer end
+// with END_OF_FILE, so scans that stop on an END token stay inside them.
+// Scans that may not meet one check end().
+class TokenSpan {
+public:
+  typedef const pToken* iterator;
+
+  TokenSpan(): first(nullptr), last(nullptr) {}
+  TokenSpan(iterator b, iterator e): first(b), last(e) {}
+  TokenSpan(const Tokens& t): first(t.data()), last(t.data() + t.size()) {}
+
+  iterator begin() const { return first; }
+  iterator end() const { return last; }
+  size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  const pToken& operator[](size_t i) const { return first[i]; }
+
+private:
+  iterator first;
+  iterator last;
+};
+
 struct Token {
-  Token(TokenType t = TokenType::UNDEFINED): type(t), literal(tokenTypeToString[t]) {}
+  Token(TokenType t = TokenType::UNDEFINED): literal(tokenTraits(t).name), type(t) {}
   Token(
     std::string l,
-    TokenType t = TokenType::UNDEFINED): type(t), literal(l) {}
+    TokenType t = TokenType::UNDEFINED): literal(l), type(t) {
+    if (t == TokenType::WORD) {
+      symbol = symbols::intern(literal, generation);
+    }
+  }
 
   virtual std::string verboseToken() {
     return literal;
   }
 
-  bool isTypeOf(std::vector<TokenType> types) {
-    for (auto _type : types) {
-      if (type == _type) {
-        return true;
-      }
-    }
-    return false;
+  bool isTypeOf(TokenTypeSet types) const {
+    return types.contains(type);
   }
 
   std::string typeToString() {
     return tokenTypeToString[type];
   }
 
-  bool isTypeOf(TokenType comp) {
+  bool isTypeOf(TokenType comp) const {
     return type == comp;
   }
 
+  // words of one generation are compared by their interned symbol
+  bool sameLiteral(const Token& t) const {
+    if (symbol != 0 && t.symbol != 0 && generation == t.generation) {
+      return symbol == t.symbol;
+    }
+    return literal == t.literal;
+  }
+
   bool operator==(const Token& t) {
-    return type == t.type && literal == t.literal;
+    return type == t.type && sameLiteral(t);
   }
 
   bool operator!=(const Token& t) {
-    return !(type == t.type && literal == t.literal);
+    return !(*this == t);
   }
 
   std::string literal;
   TokenType type;
-  std::shared_ptr<Token> partOf;
-  std::shared_ptr<Token> next;
-  std::shared_ptr<Token> prev;
-  std::shared_ptr<Token> relatedTo;
+  Symbol symbol = 0; // interned literal of WORD tokens
+  uint32_t generation = 0; // of the table symbol is from, see symbols::reset
+  // of the first byte, for statements the first byte of their line
+  SourceLocation location = NO_LOCATION;
+  // Links between tokens do not own, owning links in both directions would
+  // be reference cycles. Tokens are owned by the Tokens they are in.
+  Token* partOf = nullptr;
+  Token* next = nullptr;
+  Token* prev = nullptr;
+  Token* relatedTo = nullptr;
 };
 
 inline bool operator==(const pToken& lht, const pToken& rht) {
@@ -61,7 +101,9 @@ inline bool operator!=(const pToken& lht, const pToken& rht) {
 // some helpers
 
 namespace token {
-  const std::vector<TokenType> END = { TokenType::ENDL, TokenType::END_OF_FILE };
+  constexpr TokenTypeSet END = tokenTypesOf(tokenCategory::END);
+  constexpr TokenTypeSet PREFIX = tokenTypesOf(tokenCategory::PREFIX);
+  constexpr TokenTypeSet INFIX = tokenTypesOf(tokenCategory::INFIX);
   inline void linkTokens(Tokens& tokens) {
     /*
     if (tokens.size() < 2) {
@@ -69,8 +111,8 @@ namespace token {
     }
 
     for (u_int i = 1; i < tokens.size(); ++i) {
-      tokens[i - 1]->next = tokens[i];
-      tokens[i]->prev = tokens[i - 1];
+      tokens[i - 1]->next = tokens[i].get();
+      tokens[i]->prev = tokens[i - 1].get();
     }
     */
   }
@@ -248,6 +290,10 @@ struct PreToken;
 typedef std::shared_ptr<PreToken> pPreToken;
 typedef std::vector<pPreToken> PreTokens;
 
+// position of a pre token in its PreArena
+typedef uint32_t PreIndex;
+constexpr PreIndex NO_PRE_INDEX = UINT32_MAX;
+
 struct PreToken: public Token {
   PreToken(TokenType t = TokenType::PRE_TOKEN): Token(t) {}
 
@@ -278,6 +324,57 @@ struct PreToken: public Token {
   }
 
   Tokens tokens = {};
+  PreIndex index = NO_PRE_INDEX; // set when made by a PreArena
+};
+
+struct PreScope;
+
+// Owner list of the pre tokens of one compilation, not a memory arena: each
+// pre token is still its own make_shared allocation, and PreToken::tokens
+// and the AST hold shared pointers to them. What it does is break cycles.
+// Pre tokens that would point back up the tree (PreScope::broader) or
+// across it refer to each other by PreIndex instead, so the graph has no
+// reference cycles and a pre token is freed once the arena and the last
+// other holder let it go. Scope links made by an arena have to be followed
+// while the arena is alive.
+class PreArena {
+public:
+  PreArena() {}
+  PreArena(const PreArena&) = delete;
+  PreArena& operator=(const PreArena&) = delete;
+
+  template <typename T, typename... Args>
+  std::shared_ptr<T> make(Args&&... args) {
+    auto token = std::make_shared<T>(std::forward<Args>(args)...);
+    token->index = tokens.size();
+    if constexpr (std::is_base_of_v<PreScope, T>) {
+      token->arena = this;
+    }
+    tokens.push_back(token);
+    return token;
+  }
+
+  template <typename T = PreToken>
+  std::shared_ptr<T> at(PreIndex i) const {
+    return std::static_pointer_cast<T>(tokens[i]);
+  }
+
+  // non owning access, no reference counting
+  template <typename T = PreToken>
+  T* get(PreIndex i) const {
+    return static_cast<T*>(tokens[i].get());
+  }
+
+  size_t size() const {
+    return tokens.size();
+  }
+
+  void clear() {
+    tokens.clear();
+  }
+
+protected:
+  PreTokens tokens;
 };
 
 struct PreCall: public PreToken {
@@ -360,19 +457,67 @@ struct PreBlock: public PreToken {
   u_int depth;
 };
 
-struct PreScope;
 typedef std::shared_ptr<PreScope> pPreScope;
 typedef std::vector<pPreScope> PreScopes;
 typedef std::shared_ptr<PreIdentifier> pPreIdentifier;
 typedef std::vector<pPreIdentifier> PreIdentifiers;
 
+// Identifiers are phrases of words and parameter slots. A call matches a
+// declared phrase when the words are the same and the parameters are in the
+// same places, whatever is passed in them.
+namespace phrase {
+  inline bool sameSlot(const Token& declared, const Token& called) {
+    if (declared.type == TokenType::PARAMETER && called.type == TokenType::PARAMETER) {
+      return true;
+    }
+    return declared.type == called.type && declared.sameLiteral(called);
+  }
+
+  inline bool matches(const PreToken& declared, const PreToken& called) {
+    if (declared.tokens.size() != called.tokens.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < declared.tokens.size(); ++i) {
+      if (!sameSlot(*declared.tokens[i], *called.tokens[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Hash of the shape: arity, words and parameter slots. Matching phrases
+  // have the same shape. Words are hashed by their literal, a declaration
+  // and its call can have symbols of different generations.
+  inline uint64_t shape(const PreToken& identifier) {
+    uint64_t hash = 14695981039346656037ull ^ identifier.tokens.size();
+    for (auto& t : identifier.tokens) {
+      uint64_t slot = t->type == TokenType::PARAMETER ? 0 : std::hash<std::string>()(t->literal);
+      hash = (hash ^ (slot + (uint64_t(t->type) << 32))) * 1099511628211ull;
+    }
+    return hash;
+  }
+};
+
+// Scopes own their tokens (narrower scopes included) and link to their
+// broader and narrower scopes by index in the arena that made them.
 struct PreScope: public PreToken {
-  PreScope(pPreScope b = nullptr): PreToken(TokenType::SCOPE), broader(b) {}
+  PreScope(): PreToken(TokenType::SCOPE) {}
 
   u_int depth;
-  pPreScope broader;
-  PreScopes narrower;
+  PreIndex broader = NO_PRE_INDEX;
+  std::vector<PreIndex> narrower;
   PreIdentifiers identifiers;
+  // identifiers by phrase shape, in the order they were added
+  std::unordered_map<uint64_t, std::vector<u_int>> phrases;
+  PreArena* arena = nullptr;
+
+  PreScope* broaderScope() const {
+    return broader == NO_PRE_INDEX ? nullptr : arena->get<PreScope>(broader);
+  }
+
+  PreScope* narrowerScope(u_int i) const {
+    return arena->get<PreScope>(narrower[i]);
+  }
 
   std::string intend() {
     std::string res = "";
@@ -384,21 +529,35 @@ struct PreScope: public PreToken {
 
   std::string verboseToken() override {
     std::string r;
-    for (auto t : tokens) {
+    for (auto& t : tokens) {
       r += intend() + t->verboseToken();
     }
     return r;
   }
 
-  void addIdentifier(pToken t) {
-    if (t->isTypeOf(TokenType::IDENTIFIER)) {
-      auto id = std::dynamic_pointer_cast<PreIdentifier>(t);
-      identifiers.push_back(id);
-      return;
+  // false when t is not an identifier, nothing is added then
+  bool addIdentifier(pToken t) {
+    if (!t->isTypeOf(TokenType::IDENTIFIER)) {
+      return false;
     }
+    auto id = std::static_pointer_cast<PreIdentifier>(t);
+    phrases[phrase::shape(*id)].push_back(identifiers.size());
+    identifiers.push_back(id);
+    return true;
+  }
 
-    std::cerr << "PreScope: addIdentifier: wrong type of token\n";
-    std::exit(123);
+  // the first identifier of this scope that the called phrase matches
+  const pPreIdentifier* findPhrase(const PreToken& called, uint64_t shape) const {
+    auto found = phrases.find(shape);
+    if (found == phrases.end()) {
+      return nullptr;
+    }
+    for (auto i : found->second) {
+      if (phrase::matches(*identifiers[i], called)) {
+        return &identifiers[i];
+      }
+    }
+    return nullptr;
   }
 
   std::string verboseIdentifiers() {
@@ -412,8 +571,8 @@ struct PreScope: public PreToken {
 
   std::string verboseIdentifiersRecursively() {
     auto res = verboseIdentifiers();
-    for (auto s : narrower) {
-      res += s->verboseIdentifiersRecursively();
+    for (auto i : narrower) {
+      res += arena->get<PreScope>(i)->verboseIdentifiersRecursively();
     }
 
     return res;
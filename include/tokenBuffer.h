@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+// Lightweight by-value view of a single buffered token. It mirrors the parts of
+// the Token interface that scanning code uses, so `(*it)->isTypeOf(...)` works
+// the same for Tokens::iterator and TokenBuffer::iterator.
+struct TokenRef {
+  TokenType type;
+  std::string_view literal;
+  double value;
+  Symbol symbol;
+
+  bool isTypeOf(TokenType comp) const {
+    return type == comp;
+  }
+
+  bool isTypeOf(TokenTypeSet types) const {
+    return types.contains(type);
+  }
+
+  std::string typeToString() const {
+    return tokenTypeToString[type];
+  }
+
+  const TokenRef* operator->() const {
+    return this;
+  }
+};
+
+// Struct-of-arrays token storage. Tokens are stored as parallel arrays of type,
+// source offset and length plus the number and symbol payloads, and literals
+// are views into the source buffer that the lexer borrowed. The buffer does
+// not own the source, the source must outlive the buffer. The location of a
+// token is base plus its offset. All symbols of a buffer are from table, the
+// current one when the buffer was made.
+struct TokenBuffer {
+  TokenBuffer(std::string_view src = {}, SourceLocation b = FIRST_LOCATION): source(src), base(b) {}
+
+  class iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = TokenRef;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const TokenRef*;
+    using reference = TokenRef;
+
+    iterator(const TokenBuffer* b = nullptr, u_int i = 0): buffer(b), index(i) {}
+
+    TokenRef operator*() const { return buffer->at(index); }
+    TokenRef operator[](difference_type n) const { return buffer->at(index + n); }
+    iterator& operator++() { ++index; return *this; }
+    iterator operator++(int) { auto copy = *this; ++index; return copy; }
+    iterator& operator--() { --index; return *this; }
+    iterator operator--(int) { auto copy = *this; --index; return copy; }
+    iterator& operator+=(difference_type n) { index += n; return *this; }
+    iterator& operator-=(difference_type n) { index -= n; return *this; }
+    iterator operator+(difference_type n) const { return iterator(buffer, index + n); }
+    iterator operator-(difference_type n) const { return iterator(buffer, index - n); }
+    difference_type operator-(const iterator& other) const { return difference_type(index) - difference_type(other.index); }
+    bool operator==(const iterator& other) const { return index == other.index; }
+    bool operator!=(const iterator& other) const { return index != other.index; }
+    bool operator<(const iterator& other) const { return index < other.index; }
+
+    const TokenBuffer* buffer;
+    u_int index;
+  };
+
+  void push(TokenType type, uint32_t offset, uint32_t length);
+  void clear();
+
+  size_t size() const { return types.size(); }
+  TokenType type(u_int i) const { return static_cast<TokenType>(types[i]); }
+  std::string_view literal(u_int i) const { return source.substr(offsets[i], lengths[i]); }
+  double number(u_int i) const { return numbers[i]; }
+  Symbol symbol(u_int i) const { return symbols[i]; }
+  TokenRef at(u_int i) const { return { type(i), literal(i), numbers[i], symbols[i] }; }
+  SourceLocation location(u_int i) const { return base + offsets[i]; }
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size()); }
+
+  // materialize heap tokens for the stages that still work on Tokens
+  pToken toToken(u_int i) const;
+  Tokens toTokens() const;
+
+  std::string_view source;
+  SourceLocation base;
+  std::vector<uint8_t> types;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> lengths;
+  std::vector<double> numbers; // pre-parsed value of NUMBER tokens, 0 for others
+  std::vector<Symbol> symbols; // interned literal of WORD tokens, 0 for others
+  pSymbolTable table = symbols::current();
+};
+
+namespace token {
+  // create a heap token of the given type. Literal is copied into the token
+  // and no type specific subclass is constructed.
+  pToken make(TokenType type, std::string_view literal, SourceLocation location = NO_LOCATION);
+};
@@ -1,8 +1,15 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 enum class TokenType {
     UNDEFINED,
+    INVALID, // text that did not lex, the lexer reports it as a diagnostic
 
     MINUS,
     PLUS,
@@ -51,97 +58,201 @@ enum class TokenType {
     END_OF_FILE,
 };
 
-typedef std::vector<TokenType> TokenTypes;
-
-static std::unordered_map<std::string, TokenType> stringToTokenType{
-    {"undefined", TokenType::UNDEFINED},
-
-    { "-", TokenType::MINUS },
-    { "+", TokenType::PLUS },
-    { "*", TokenType::ASTERISK },
-    { "/", TokenType::SLASH },
-    { "=", TokenType::EQUALS },
-
-    { "word", TokenType::WORD },
-    { "number", TokenType::NUMBER },
-
-    { "#", TokenType::HASH },
-    { "(", TokenType::LBRACE },
-    { ")", TokenType::RBRACE },
-    { "[", TokenType::LBRACKET },
-    { "]", TokenType::RBRACKET },
-    { ":", TokenType::COLON },
-    { "!", TokenType::BANG },
-    { "_", TokenType::UNDERSCORE },
-
-    { "==", TokenType::EQUALS_COMPARE },
-    { "!=", TokenType::NOT_EQUALS },
-    { ">", TokenType::GT },
-    { "<", TokenType::LT },
-    { ">=", TokenType::GT_OR_EQUALS },
-    { "<=", TokenType::LT_OR_EQUALS },
-
-    { "IMPORT", TokenType::IMPORT },
-    { "FROM", TokenType::FROM },
-    { "DECLARE", TokenType::DECLARE },
-    { "ASSIGN", TokenType::ASSIGN },
-    { "WITH", TokenType::WITH },
-    { "IDENTIFIER", TokenType::IDENTIFIER },
-    { "PARAMETER", TokenType::PARAMETER },
-    { "EXPRESSION", TokenType::EXPRESSION },
-    { "EXPRESSION_STATEMENT", TokenType::EXPRESSION_STATEMENT },
-    { "CALL", TokenType::CALL },
-    { "ARGUMENT", TokenType::ARGUMENT },
-
-    { "PRINT", TokenType::PRINT },
-    { "JOIN", TokenType::JOIN },
-
-    { "\n", TokenType::ENDL },
-    { "", TokenType::END_OF_FILE },
+constexpr size_t tokenTypeCount = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+
+// Set of token types as a bitmask, so membership is a single bit test and
+// sets are built at compile time without allocating.
+class TokenTypeSet {
+public:
+    constexpr TokenTypeSet() {}
+    constexpr TokenTypeSet(TokenType type): bits(bit(type)) {}
+    constexpr TokenTypeSet(std::initializer_list<TokenType> types) {
+        for (auto type : types) {
+            bits |= bit(type);
+        }
+    }
+
+    constexpr bool contains(TokenType type) const {
+        return (bits & bit(type)) != 0;
+    }
+
+    constexpr bool empty() const {
+        return bits == 0;
+    }
+
+    constexpr TokenTypeSet operator|(TokenTypeSet other) const {
+        TokenTypeSet set;
+        set.bits = bits | other.bits;
+        return set;
+    }
+
+    constexpr bool operator==(TokenTypeSet other) const {
+        return bits == other.bits;
+    }
+
+    constexpr bool operator!=(TokenTypeSet other) const {
+        return bits != other.bits;
+    }
+
+private:
+    static constexpr uint64_t bit(TokenType type) {
+        return uint64_t(1) << static_cast<unsigned>(type);
+    }
+
+    uint64_t bits = 0;
+};
+
+static_assert(tokenTypeCount <= 64, "TokenTypeSet holds at most 64 token types");
+
+typedef TokenTypeSet TokenTypes;
+
+// binding power of infix operators, higher binds tighter
+enum class ExprOrder {
+    LOWEST = 0,
+    EQUALS,
+    LESSGREATER,
+    SUM,
+    PPRODUCT,
+    PREFIX
+};
+
+// Roles of a token type in expressions, TokenSpec::category is a mask of these.
+namespace tokenCategory {
+    constexpr uint8_t NONE = 0;
+    constexpr uint8_t PREFIX = 1 << 0; // can start an expression
+    constexpr uint8_t INFIX = 1 << 1;  // binary operator, has a precedence
+    constexpr uint8_t END = 1 << 2;    // ends a line
+};
+
+// Single spec of every token type, in the order of the enum. name is what
+// tokenTypeToString gives and what stringToTokenType accepts. lexeme is the
+// one or two characters the lexer turns into the token, empty when the token
+// is not lexed from fixed characters. The lexer dispatch tables are generated
+// from this (lexerTables.h) so new operators only need a line here.
+struct TokenSpec {
+    TokenType type;
+    std::string_view name;
+    std::string_view lexeme;
+    ExprOrder precedence = ExprOrder::LOWEST;
+    uint8_t category = tokenCategory::NONE;
+};
+
+constexpr TokenSpec tokenSpecs[] = {
+    { TokenType::UNDEFINED, "undefined", "" },
+    { TokenType::INVALID, "invalid", "" },
+
+    { TokenType::MINUS, "-", "-", ExprOrder::SUM, tokenCategory::PREFIX | tokenCategory::INFIX },
+    { TokenType::PLUS, "+", "+", ExprOrder::SUM, tokenCategory::INFIX },
+    { TokenType::ASTERISK, "*", "*", ExprOrder::PPRODUCT, tokenCategory::INFIX },
+    { TokenType::SLASH, "/", "/", ExprOrder::PPRODUCT, tokenCategory::INFIX },
+    { TokenType::EQUALS, "=", "=" },
+
+    { TokenType::WORD, "word", "" },
+    { TokenType::NUMBER, "number", "", ExprOrder::LOWEST, tokenCategory::PREFIX },
+
+    { TokenType::HASH, "#", "#" },
+    { TokenType::LBRACE, "(", "(" },
+    { TokenType::RBRACE, ")", ")" },
+    { TokenType::LBRACKET, "[", "[" },
+    { TokenType::RBRACKET, "]", "]" },
+    { TokenType::COLON, ":", ":" },
+    { TokenType::BANG, "!", "!", ExprOrder::LOWEST, tokenCategory::PREFIX },
+    { TokenType::UNDERSCORE, "_", "_" },
+
+    { TokenType::EQUALS_COMPARE, "==", "==", ExprOrder::EQUALS, tokenCategory::INFIX },
+    { TokenType::NOT_EQUALS, "!=", "!=", ExprOrder::EQUALS, tokenCategory::INFIX },
+    { TokenType::GT, ">", ">", ExprOrder::LESSGREATER, tokenCategory::INFIX },
+    { TokenType::LT, "<", "<", ExprOrder::LESSGREATER, tokenCategory::INFIX },
+    { TokenType::GT_OR_EQUALS, ">=", ">=", ExprOrder::LESSGREATER, tokenCategory::INFIX },
+    { TokenType::LT_OR_EQUALS, "<=", "<=", ExprOrder::LESSGREATER, tokenCategory::INFIX },
+
+    { TokenType::PRE_TOKEN, "PRE_TOKEN", "" },
+    { TokenType::IMPORT, "IMPORT", "", ExprOrder::LOWEST, tokenCategory::PREFIX },
+    { TokenType::FROM, "FROM", "" },
+    { TokenType::DECLARE, "DECLARE", "" },
+    { TokenType::ASSIGNMENT, "ASSIGN", "" },
+    { TokenType::EXPRESSION_STATEMENT, "EXPRESSION_STATEMENT", "" },
+    { TokenType::WITH, "WITH", "" },
+    { TokenType::IDENTIFIER, "IDENTIFIER", "" },
+    { TokenType::PARAMETER, "PARAMETER", "" },
+    { TokenType::EXPRESSION, "EXPRESSION", "" },
+    { TokenType::CALL, "CALL", "", ExprOrder::LOWEST, tokenCategory::PREFIX },
+    { TokenType::ARGUMENT, "ARGUMENT", "" },
+    { TokenType::BLOCK, "BLOCK", "" },
+    { TokenType::SCOPE, "SCOPE", "" },
+
+    { TokenType::PRINT, "PRINT", "" },
+    { TokenType::JOIN, "JOIN", "" },
+
+    { TokenType::ENDL, "\n", "\n", ExprOrder::LOWEST, tokenCategory::END },
+    { TokenType::END_OF_FILE, "EOF", "", ExprOrder::LOWEST, tokenCategory::END },
+};
+
+constexpr bool specsFollowEnum() {
+    if (std::size(tokenSpecs) != tokenTypeCount) {
+        return false;
+    }
+    for (size_t i = 0; i < tokenTypeCount; ++i) {
+        if (static_cast<size_t>(tokenSpecs[i].type) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(specsFollowEnum(), "tokenSpecs needs one line per TokenType in the order of the enum");
+
+// the expression parser reads the precedence of any token after an operand
+// and stops at LOWEST, so only infix operators may have one
+constexpr bool onlyInfixHavePrecedence() {
+    for (auto& spec : tokenSpecs) {
+        if ((spec.category & tokenCategory::INFIX) == 0 && spec.precedence != ExprOrder::LOWEST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(onlyInfixHavePrecedence(), "only infix token types can have a precedence");
+
+constexpr const TokenSpec& tokenTraits(TokenType type) {
+    return tokenSpecs[static_cast<size_t>(type)];
+}
+
+// every token type of a category
+constexpr TokenTypeSet tokenTypesOf(uint8_t category) {
+    TokenTypeSet set;
+    for (auto& spec : tokenSpecs) {
+        if ((spec.category & category) != 0) {
+            set = set | spec.type;
+        }
+    }
+    return set;
+}
+
+inline const std::unordered_map<std::string, TokenType> stringToTokenType = []() {
+    std::unordered_map<std::string, TokenType> map;
+    for (auto& spec : tokenSpecs) {
+        map[std::string(spec.name)] = spec.type;
+    }
+    // end of file has no characters
+    map[""] = TokenType::END_OF_FILE;
+    return map;
+}();
+
+// Names as strings for code that builds messages, indexed like an array.
+// The strings are made once per program, not per translation unit.
+struct TokenTypeNames {
+    const std::string& operator[](TokenType type) const {
+        static const auto names = []() {
+            std::array<std::string, tokenTypeCount> names;
+            for (auto& spec : tokenSpecs) {
+                names[static_cast<size_t>(spec.type)] = std::string(spec.name);
+            }
+            return names;
+        }();
+        return names[static_cast<size_t>(type)];
+    }
 };
 
-static std::unordered_map<TokenType, std::string> tokenTypeToString{
-    {TokenType::UNDEFINED, "undefined"},
-
-    { TokenType::MINUS, "-" },
-    { TokenType::PLUS, "+" },
-    { TokenType::ASTERISK, "*" },
-    { TokenType::SLASH, "/" },
-    { TokenType::EQUALS, "=" },
-
-    { TokenType::WORD, "word" },
-    { TokenType::NUMBER, "number" },
-
-    { TokenType::HASH, "#" },
-    { TokenType::LBRACE, "(" },
-    { TokenType::RBRACE, ")" },
-    { TokenType::LBRACKET, "[" },
-    { TokenType::RBRACKET, "]" },
-    { TokenType::COLON, ":" },
-    { TokenType::BANG, "!" },
-    { TokenType::UNDERSCORE, "_" },
-
-    { TokenType::EQUALS_COMPARE, "==" },
-    { TokenType::NOT_EQUALS, "!=" },
-    { TokenType::GT, ">" },
-    { TokenType::LT, "<" },
-    { TokenType::GT_OR_EQUALS, ">=" },
-    { TokenType::LT_OR_EQUALS, "<=" },
-
-    { TokenType::IMPORT, "IMPORT" },
-    { TokenType::FROM, "FROM" },
-    { TokenType::DECLARE, "DECLARE" },
-    { TokenType::ASSIGN, "ASSIGN" },
-    { TokenType::WITH, "WITH" },
-    { TokenType::IDENTIFIER, "IDENTIFIER" },
-    { TokenType::PARAMETER, "PARAMETER" },
-    { TokenType::EXPRESSION, "EXPRESSION" },
-    { TokenType::EXPRESSION_STATEMENT, "EXPRESSION_STATEMENT" },
-    { TokenType::CALL, "CALL" },
-    { TokenType::ARGUMENT, "ARGUMENT" },
-
-    { TokenType::PRINT, "PRINT" },
-    { TokenType::JOIN, "JOIN" },
-
-    { TokenType::ENDL, "\n" },
-    { TokenType::END_OF_FILE, "EOF" } };
+inline constexpr TokenTypeNames tokenTypeToString;
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+
+// UTF-8 decoding and letter classification for the Lexer. Classification is
+// a range table approximating the Unicode letter (L) and combining mark (M)
+// categories for the common scripts: Latin, Greek, Cyrillic, Armenian,
+// Hebrew, Arabic, Devanagari, Thai, Georgian, CJK, kana and Hangul.
+namespace utf8 {
+  // Decodes one code point from p. Returns the length of the sequence, or 0
+  // for a malformed or overlong sequence, a surrogate or a truncated tail.
+  size_t decode(const char* p, size_t n, char32_t& codePoint);
+
+  // can start a word
+  bool isLetter(char32_t codePoint);
+
+  // can continue a word: letters and combining marks
+  bool isWordLetter(char32_t codePoint);
+
+  // Length of the run of word letters starting from p, ASCII [a-zA-Z0-9.-]
+  // included. Stops before the first byte that is not part of a word.
+  size_t wordRun(const char* p, size_t n, size_t (*asciiRun)(const char*, size_t));
+};
@@ -0,0 +1,232 @@
+#include "astArena.h"
+
+using ast::Kind;
+using ast::NodeIndex;
+using ast::NO_NODE;
+
+namespace {
+
+  std::string intend(u_int in) {
+    return std::string(in * 2, ' ');
+  }
+
+  // a child that is missing prints as nothing
+  template <typename Visitor>
+  std::string visitChild(const AstArena& arena, NodeIndex i, Visitor& visitor) {
+    return i == NO_NODE ? "" : arena.visit(i, visitor);
+  }
+
+  struct ToString {
+    std::string program(const AstArena& arena, NodeIndex i) {
+      std::string out;
+      for (auto statement : arena.list(arena.node(i).a)) {
+        out += arena.visit(statement, *this);
+      }
+      return out;
+    }
+
+    std::string expressionStatement(const AstArena& arena, NodeIndex i) {
+      auto expression = arena.node(i).a;
+      return expression == NO_NODE ? "" : arena.visit(expression, *this) + "\n";
+    }
+
+    std::string declaration(const AstArena& arena, NodeIndex i) {
+      auto& node = arena.node(i);
+      return "# " + visitChild(arena, node.a, *this) + "\n" + visitChild(arena, node.b, *this);
+    }
+
+    std::string assignment(const AstArena& arena, NodeIndex i) {
+      auto& node = arena.node(i);
+      std::string res = "(";
+      auto params = arena.list(node.a);
+      for (auto param : params) {
+        res += arena.visit(param, *this) + ", ";
+      }
+      if (params.size() > 0) {
+        res.erase(res.size() - 2);
+      }
+      return res + ") = " + visitChild(arena, node.b, *this) + "\n";
+    }
+
+    std::string number(const AstArena& arena, NodeIndex i) {
+      return AstNumber::toString(arena.number(i));
+    }
+
+    std::string prefix(const AstArena& arena, NodeIndex i) {
+      return arena.token(i)->literal + arena.visit(arena.node(i).a, *this);
+    }
+
+    std::string infix(const AstArena& arena, NodeIndex i) {
+      auto& node = arena.node(i);
+      return "(" + arena.visit(node.a, *this) + " " + arena.token(i)->literal + " " + arena.visit(node.b, *this) + ")";
+    }
+
+    std::string call(const AstArena& arena, NodeIndex i) {
+      return arena.token(i)->verboseToken();
+    }
+
+    std::string identifier(const AstArena& arena, NodeIndex i) {
+      return arena.token(i)->verboseToken();
+    }
+
+    std::string parameter(const AstArena& arena, NodeIndex i) {
+      return "";
+    }
+  };
+
+  struct TypeToString {
+    u_int in = 0;
+
+    std::string at(const AstArena& arena, NodeIndex i, u_int depth) {
+      auto outer = in;
+      in = depth;
+      auto out = arena.visit(i, *this);
+      in = outer;
+      return out;
+    }
+
+    std::string program(const AstArena& arena, NodeIndex i) {
+      std::string out = intend(in) + "PROGRAM\n";
+      for (auto statement : arena.list(arena.node(i).a)) {
+        out += at(arena, statement, in + 1);
+      }
+      return out;
+    }
+
+    std::string expressionStatement(const AstArena& arena, NodeIndex i) {
+      return intend(in) + "EXPRESSION_STATEMENT->" + visitChild(arena, arena.node(i).a, *this) + "\n";
+    }
+
+    std::string declaration(const AstArena& arena, NodeIndex i) {
+      auto& node = arena.node(i);
+      return intend(in) + "DECLARATION " + visitChild(arena, node.a, *this) + "\n" + visitChild(arena, node.b, *this);
+    }
+
+    std::string assignment(const AstArena& arena, NodeIndex i) {
+      return "";
+    }
+
+    std::string number(const AstArena& arena, NodeIndex i) {
+      return "NUMBER";
+    }
+
+    std::string prefix(const AstArena& arena, NodeIndex i) {
+      return tokenTypeToString[arena.token(i)->type] + arena.visit(arena.node(i).a, *this);
+    }
+
+    std::string infix(const AstArena& arena, NodeIndex i) {
+      auto& node = arena.node(i);
+      return arena.visit(node.a, *this) + " " + tokenTypeToString[arena.token(i)->type] + " " + arena.visit(node.b, *this);
+    }
+
+    std::string call(const AstArena& arena, NodeIndex i) {
+      u_int numParams = 0;
+      for (auto& t : static_cast<const PreToken&>(*arena.token(i)).tokens) {
+        if (t->isTypeOf(TokenType::PARAMETER)) {
+          ++numParams;
+        }
+      }
+      return "CALL(" + std::to_string(numParams) + ")";
+    }
+
+    std::string identifier(const AstArena& arena, NodeIndex i) {
+      return "IDENTIFIER";
+    }
+
+    std::string parameter(const AstArena& arena, NodeIndex i) {
+      return "PARAM";
+    }
+  };
+};
+
+NodeIndex AstArena::add(Kind kind, pToken token, NodeIndex a, NodeIndex b) {
+  ast::Node node = { kind, NO_NODE, a, b };
+  if (token != nullptr) {
+    node.token = tokens.size();
+    tokens.push_back(std::move(token));
+  }
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+NodeIndex AstArena::addNumber(pToken token, double value) {
+  numbers.push_back(value);
+  return add(Kind::NUMBER, std::move(token), numbers.size() - 1);
+}
+
+NodeIndex AstArena::addList(const std::vector<NodeIndex>& items) {
+  NodeIndex index = lists.size();
+  lists.push_back(items.size());
+  lists.insert(lists.end(), items.begin(), items.end());
+  return index;
+}
+
+NodeIndex AstArena::add(const pAstNode& node) {
+  if (node == nullptr) {
+    return NO_NODE;
+  }
+
+  if (auto program = std::dynamic_pointer_cast<AstProgram>(node)) {
+    std::vector<NodeIndex> statements;
+    for (auto& statement : program->statements) {
+      statements.push_back(add(statement));
+    }
+    return add(Kind::PROGRAM, nullptr, addList(statements));
+  }
+  if (auto statement = std::dynamic_pointer_cast<AstExpressionStatement>(node)) {
+    return add(Kind::EXPRESSION_STATEMENT, statement->token, add(statement->expression));
+  }
+  if (auto declaration = std::dynamic_pointer_cast<AstDeclarationStatement>(node)) {
+    auto name = add(declaration->name);
+    return add(Kind::DECLARATION, declaration->token, name, add(declaration->scope));
+  }
+  if (auto assignment = std::dynamic_pointer_cast<AstAssignment>(node)) {
+    std::vector<NodeIndex> params;
+    for (auto& param : assignment->params) {
+      params.push_back(add(param));
+    }
+    auto list = addList(params);
+    return add(Kind::ASSIGNMENT, assignment->token, list, add(assignment->value));
+  }
+  if (auto number = std::dynamic_pointer_cast<AstNumber>(node)) {
+    return addNumber(number->token, number->value);
+  }
+  if (auto prefix = std::dynamic_pointer_cast<AstPrefixExpression>(node)) {
+    return add(Kind::PREFIX, prefix->token, add(prefix->right));
+  }
+  if (auto infix = std::dynamic_pointer_cast<AstInfixExpression>(node)) {
+    auto left = add(infix->left);
+    return add(Kind::INFIX, infix->token, left, add(infix->right));
+  }
+  if (auto call = std::dynamic_pointer_cast<AstCall>(node)) {
+    return add(Kind::CALL, call->identifier);
+  }
+  if (auto identifier = std::dynamic_pointer_cast<AstIdentifier>(node)) {
+    return add(Kind::IDENTIFIER, identifier->name);
+  }
+  return add(Kind::PARAMETER, node->token);
+}
+
+size_t AstArena::bytes() const {
+  return nodes.capacity() * sizeof(ast::Node) +
+    lists.capacity() * sizeof(NodeIndex) +
+    tokens.capacity() * sizeof(pToken) +
+    numbers.capacity() * sizeof(double);
+}
+
+void AstArena::clear() {
+  nodes.clear();
+  lists.clear();
+  tokens.clear();
+  numbers.clear();
+}
+
+std::string AstArena::toString(NodeIndex i) const {
+  ToString visitor;
+  return visit(i, visitor);
+}
+
+std::string AstArena::typeToString(NodeIndex i, u_int in) const {
+  TypeToString visitor = { in };
+  return visit(i, visitor);
+}
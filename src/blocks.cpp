@@ -0,0 +1,130 @@
+#include "blocks.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+  struct Fence {
+    char marker = 0; // 0 when no fence is open
+    size_t length = 0;
+  };
+
+  inline bool isBlankByte(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  inline bool isBlank(const char* p, size_t n) {
+    return std::all_of(p, p + n, isBlankByte);
+  }
+
+  // leading spaces, at most 4. 4 makes an indented code line which is
+  // neither a heading nor a fence.
+  inline size_t indentation(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && i < 4 && p[i] == ' ') {
+      ++i;
+    }
+    return i;
+  }
+
+  inline size_t markerRun(const char* p, size_t n, size_t i, char marker) {
+    auto start = i;
+    while (i < n && p[i] == marker) {
+      ++i;
+    }
+    return i - start;
+  }
+
+  // Opening fence: at least 3 backticks or tildes. The info string after
+  // backticks cannot hold a backtick.
+  bool opensFence(const char* p, size_t n, Fence& fence) {
+    auto i = indentation(p, n);
+    if (i == 4 || i == n || (p[i] != '`' && p[i] != '~')) {
+      return false;
+    }
+    auto marker = p[i];
+    auto length = markerRun(p, n, i, marker);
+    if (length < 3) {
+      return false;
+    }
+    i += length;
+    if (marker == '`' && std::memchr(p + i, '`', n - i) != nullptr) {
+      return false;
+    }
+    fence = { marker, length };
+    return true;
+  }
+
+  // Closing fence: the opening marker at least as many times and nothing else
+  bool closesFence(const char* p, size_t n, const Fence& fence) {
+    auto i = indentation(p, n);
+    if (i == 4) {
+      return false;
+    }
+    auto length = markerRun(p, n, i, fence.marker);
+    return length >= fence.length && isBlank(p + i + length, n - i - length);
+  }
+
+  bool isHeading(const char* p, size_t n) {
+    auto i = indentation(p, n);
+    if (i == 4) {
+      return false;
+    }
+    auto length = markerRun(p, n, i, '#');
+    i += length;
+    return length >= 1 && length <= 6 && (i == n || isBlankByte(p[i]));
+  }
+};
+
+size_t blocks::LineMap::line(uint32_t offset) const {
+  auto found = std::upper_bound(starts.begin(), starts.end(), offset);
+  return found == starts.begin() ? 0 : found - starts.begin() - 1;
+}
+
+size_t blocks::LineMap::lineAfter(uint32_t offset) const {
+  return std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+}
+
+uint32_t blocks::LineMap::nextCode(uint32_t offset) const {
+  for (auto i = line(offset); i < size(); ++i) {
+    if (isCode(kinds[i])) {
+      return std::max(starts[i], offset);
+    }
+  }
+  return end;
+}
+
+blocks::LineMap blocks::classify(std::string_view src, const scan::Kernels& kernels) {
+  LineMap map;
+  map.end = src.length();
+  Fence fence;
+
+  size_t start = 0;
+  while (start < src.length()) {
+    auto p = src.data() + start;
+    auto n = kernels.untilNewline(p, src.length() - start);
+
+    LineKind kind;
+    if (fence.marker != 0) {
+      if (closesFence(p, n, fence)) {
+        fence = {};
+        kind = LineKind::FENCE;
+      } else {
+        kind = LineKind::FENCED;
+      }
+    } else if (isBlank(p, n)) {
+      kind = LineKind::BLANK;
+    } else if (opensFence(p, n, fence)) {
+      kind = LineKind::FENCE;
+    } else if (isHeading(p, n)) {
+      kind = LineKind::HEADING;
+    } else {
+      kind = LineKind::PARAGRAPH;
+    }
+
+    map.starts.push_back(start);
+    map.kinds.push_back(kind);
+    start += n + 1;
+  }
+  return map;
+}
@@ -0,0 +1,55 @@
+#include "frontend.h"
+#include "lexer.h"
+#include "parser.h"
+#include "preparser.h"
+#include <algorithm>
+
+namespace {
+  // the stages after the lexer, diagnostics holds the problems it found
+  Compilation compileTokens(Tokens tokens, Diagnostics diagnostics) {
+    PreParser preparser(std::move(tokens));
+    preparser.prepareFromStart();
+
+    Parser parser(preparser.scoped);
+    parser.parseScope();
+
+    Compilation compilation;
+    compilation.program = parser.scope;
+    compilation.diagnostics = std::move(diagnostics);
+    for (auto stage : { &preparser.diagnostics, &parser.diagnostics }) {
+      compilation.diagnostics.insert(compilation.diagnostics.end(), stage->begin(), stage->end());
+    }
+    std::stable_sort(compilation.diagnostics.begin(), compilation.diagnostics.end(),
+      [](const Diagnostic& a, const Diagnostic& b) { return a.location < b.location; });
+    return compilation;
+  }
+};
+
+Compilation frontend::compile(std::string src) {
+  SourceManager sources;
+  auto file = sources.add("", std::move(src));
+  return compile(sources, file);
+}
+
+Compilation frontend::compile(const SourceManager& sources, FileId file) {
+  auto lexer = Lexer::borrow(sources.text(file), sources.location(file));
+  lexer.recover = true;
+  lexer.generateTokens();
+
+  auto compilation = compileTokens(std::move(lexer.tokens), std::move(lexer.diagnostics));
+  sources.resolve(compilation.diagnostics);
+  return compilation;
+}
+
+Compilation frontend::compile(const SyntaxTree& tree) {
+  auto compilation = compileTokens(tree.tokens(), tree.diagnostics());
+  for (auto& diagnostic : compilation.diagnostics) {
+    if (diagnostic.location != NO_LOCATION) {
+      auto offset = diagnostic.location - FIRST_LOCATION;
+      auto line = tree.lineAt(offset);
+      diagnostic.line = line.index + 1;
+      diagnostic.column = offset - line.offset + 1;
+    }
+  }
+  return compilation;
+}
@@ -1,150 +1,483 @@
 #include "lexer.h"
 #include "errors.h"
+#include "lexerTables.h"
+#include "utf8.h"
 #include <iostream>
+#include <exception>
+#include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+
+Lexer Lexer::borrow(std::string_view src, SourceLocation base) {
+  Lexer lexer;
+  lexer.base = base;
+  lexer.borrowed = src;
+  lexer.isBorrowed = true;
+  return lexer;
+}
+
+u_int Lexer::hardwareThreads() {
+  static const u_int threads = std::thread::hardware_concurrency();
+  return threads;
+}
+
+std::string_view Lexer::text() const {
+  if (isBorrowed) {
+    return borrowed;
+  }
+  return source;
+}
 
 void Lexer::generateTokens() {
   tokens = {};
-  while (pos < source.length()) {
-    addToken();
-    ++pos;
-  }
-  tokens.push_back(std::make_shared<EndOfFile>());
-}
-
-void Lexer::addToken() {
-  auto c = source[pos];
-  char peekToken = 0;
-  if ((pos + 1) < source.length()) {
-    peekToken = source[pos + 1];
-  }
-
-  switch (c) {
-    case ' ':
-      return;
-    case '\n':
-      tokens.push_back(std::make_shared<EndL>());
-      return;
-    case '#':
-      tokens.push_back(std::make_shared<Hash>());
-      return;
-    case '-':
-      tokens.push_back(std::make_shared<Minus>());
-      return;
-    case '+':
-      tokens.push_back(std::make_shared<Plus>());
-      return;
-    case '*':
-      tokens.push_back(std::make_shared<Asterisk>());
-      return;
-    case '/':
-      tokens.push_back(std::make_shared<Slash>());
-      return;
-    case '=':
-      if (peekToken == '=') {
-        tokens.push_back(std::make_shared<EqualsCompare>());
-        ++pos;
-        return;
-      }
-      tokens.push_back(std::make_shared<Equals>());
-      return;
-    case '(':
-      tokens.push_back(std::make_shared<LBrace>());
-      return;
-    case ')':
-      tokens.push_back(std::make_shared<RBrace>());
-      return;
-    case '[':
-      tokens.push_back(std::make_shared<LBracket>());
-      return;
-    case ']':
-      tokens.push_back(std::make_shared<RBracket>());
-      return;
-    case ':':
-      tokens.push_back(std::make_shared<Colon>());
-      return;
-    case '!':
-      if (peekToken == '=') {
-        tokens.push_back(std::make_shared<NotEquals>());
-        ++pos;
-        return;
-      }
-      tokens.push_back(std::make_shared<Bang>());
-      return;
-    case '_':
-      if (peekToken == '_') {
-        throw SYNTAX_ERROR("Double underscore is not supported");
+  pos = 0;
+  diagnostics.clear();
+  prepareBlocks();
+  if (useThreads()) {
+    for (auto& chunk : lexChunks<Tokens>(chunkBounds())) {
+      tokens.insert(tokens.end(), chunk.begin(), chunk.end());
+    }
+    pos = text().length();
+  } else {
+    appendTokens(tokens);
+  }
+  auto end = std::make_shared<EndOfFile>();
+  end->location = base + pos;
+  tokens.push_back(end);
+  tokensInStep = true;
+}
+
+void Lexer::generateTokenBuffer() {
+  buffer = TokenBuffer(text(), base);
+  pos = 0;
+  diagnostics.clear();
+  prepareBlocks();
+  if (useThreads()) {
+    for (auto& chunk : lexChunks<TokenBuffer>(chunkBounds())) {
+      buffer.types.insert(buffer.types.end(), chunk.types.begin(), chunk.types.end());
+      buffer.offsets.insert(buffer.offsets.end(), chunk.offsets.begin(), chunk.offsets.end());
+      buffer.lengths.insert(buffer.lengths.end(), chunk.lengths.begin(), chunk.lengths.end());
+      buffer.numbers.insert(buffer.numbers.end(), chunk.numbers.begin(), chunk.numbers.end());
+      buffer.symbols.insert(buffer.symbols.end(), chunk.symbols.begin(), chunk.symbols.end());
+    }
+    pos = text().length();
+  } else {
+    appendTokenBuffer(buffer);
+  }
+  buffer.push(TokenType::END_OF_FILE, pos, 0);
+}
+
+pToken Lexer::next() {
+  auto token = peek(0);
+  ring[ringStart] = nullptr;
+  ringStart = (ringStart + 1) % lookahead;
+  --ringSize;
+  return token;
+}
+
+pToken Lexer::peek(u_int n) {
+  if (n >= lookahead) {
+    throw std::out_of_range("Lexer: cannot peek further than the lookahead");
+  }
+
+  while (ringSize <= n) {
+    ring[(ringStart + ringSize) % lookahead] = pull();
+    ++ringSize;
+  }
+  return ring[(ringStart + n) % lookahead];
+}
+
+pToken Lexer::pull() {
+  if (skipBlocks && blockMap == nullptr) {
+    prepareBlocks();
+  }
+  u_int start = 0;
+  auto type = scanToken(start);
+  if (type == TokenType::END_OF_FILE) {
+    auto end = std::make_shared<EndOfFile>();
+    end->location = base + start;
+    return end;
+  }
+  return token::make(type, text().substr(start, pos - start), base + start);
+}
+
+void Lexer::prepareBlocks() {
+  blockMap = nullptr;
+  if (skipBlocks) {
+    blockMap = std::make_shared<const blocks::LineMap>(blocks::classify(text(), *kernels));
+  }
+}
+
+// lex from pos to the end of the source, without the closing EndOfFile
+void Lexer::appendTokens(Tokens& out) {
+  auto src = text();
+  u_int start = 0;
+  for (auto type = scanToken(start); type != TokenType::END_OF_FILE; type = scanToken(start)) {
+    out.push_back(token::make(type, src.substr(start, pos - start), base + start));
+  }
+}
+
+void Lexer::appendTokenBuffer(TokenBuffer& out) {
+  u_int start = 0;
+  for (auto type = scanToken(start); type != TokenType::END_OF_FILE; type = scanToken(start)) {
+    out.push(type, start, pos - start);
+  }
+}
+
+// relexLines changes the buffer and the tokens only after the edited lines
+// have lexed, so on an error only the text has to be put back.
+TokenEdit Lexer::edit(SourceEdit change) {
+  auto length = text().length();
+  checkEdit(change, length - change.removed + change.inserted.length());
+  if (isBorrowed) {
+    source = std::string(borrowed);
+    isBorrowed = false;
+  }
+  std::string removed = source.substr(change.offset, change.removed);
+  source.replace(change.offset, change.removed, change.inserted);
+  try {
+    return relexLines(change);
+  } catch (...) {
+    source.replace(change.offset, change.inserted.length(), removed);
+    // replace may have moved the text
+    buffer.source = source;
+    throw;
+  }
+}
+
+TokenEdit Lexer::relex(std::string_view edited, SourceEdit change) {
+  checkEdit(change, edited.length());
+  auto previous = borrowed;
+  bool wasBorrowed = isBorrowed;
+  borrowed = edited;
+  isBorrowed = true;
+  try {
+    return relexLines(change);
+  } catch (...) {
+    borrowed = previous;
+    isBorrowed = wasBorrowed;
+    throw;
+  }
+}
+
+// change has to lie in the current text and turn it into editedLength bytes
+void Lexer::checkEdit(SourceEdit change, size_t editedLength) const {
+  // a generated buffer ends with END_OF_FILE
+  if (buffer.offsets.empty()) {
+    throw std::logic_error("Lexer: edit before the token buffer was generated");
+  }
+  auto length = text().length();
+  if (change.offset > length || change.removed > length - change.offset ||
+    editedLength != length - change.removed + change.inserted.length()) {
+    throw std::out_of_range("Lexer: edit does not fit in the source");
+  }
+}
+
+// Tokens never span a newline, so re-lexing whole lines around the edit gives
+// exactly the tokens a full re-lex would. Bytes before the edit are the same
+// in the old and the new source and bytes after it are shifted by delta.
+TokenEdit Lexer::relexLines(SourceEdit change) {
+  auto src = text();
+  int delta = int(change.inserted.length()) - int(change.removed);
+
+  u_int lineStart = change.offset;
+  while (lineStart > 0 && src[lineStart - 1] != '\n') {
+    --lineStart;
+  }
+
+  u_int editEnd = change.offset + change.inserted.length();
+  u_int lineEnd = editEnd + kernels->untilNewline(src.data() + editEnd, src.length() - editEnd);
+  u_int oldLineEnd = lineEnd - delta;
+
+  // An edit can open or close a fence and change the kind of every line after
+  // it. Then the only correct splice is the whole source.
+  auto lineMap = blockMap;
+  if (skipBlocks) {
+    lineMap = std::make_shared<const blocks::LineMap>(blocks::classify(src, *kernels));
+    if (blockMap == nullptr || !sameKindsAfter(*blockMap, oldLineEnd, *lineMap, lineEnd) ||
+      (lineEnd < src.length() && !sameCodeAt(*blockMap, oldLineEnd, *lineMap, lineEnd))) {
+      return relexAll();
+    }
+  }
+
+  auto first = std::lower_bound(buffer.offsets.begin(), buffer.offsets.end() - 1, lineStart);
+  auto last = std::lower_bound(first, buffer.offsets.end() - 1, oldLineEnd);
+  u_int begin = first - buffer.offsets.begin();
+  u_int end = last - buffer.offsets.begin();
+
+  TokenBuffer lines(src, base);
+  lines.table = buffer.table;
+  auto lexer = Lexer::borrow(src.substr(0, lineEnd), base);
+  lexer.kernels = kernels;
+  lexer.blockMap = lineMap;
+  lexer.pos = lineStart;
+  lexer.appendTokenBuffer(lines);
+  blockMap = lineMap;
+
+  tokensInStep = tokensInStep && tokens.size() == buffer.size();
+
+  // problems of the old lines go, later ones move with their text
+  auto removedDiagnostic = [&](const Diagnostic& diagnostic) {
+    return diagnostic.location >= base + lineStart && diagnostic.location < base + oldLineEnd;
+  };
+  diagnostics.erase(std::remove_if(diagnostics.begin(), diagnostics.end(), removedDiagnostic), diagnostics.end());
+  for (auto& diagnostic : diagnostics) {
+    if (diagnostic.location >= base + oldLineEnd) {
+      diagnostic.location += delta;
+    }
+  }
+
+  for (u_int i = end; i < buffer.size(); ++i) {
+    buffer.offsets[i] += delta;
+  }
+
+  buffer.source = src;
+  buffer.types.erase(buffer.types.begin() + begin, buffer.types.begin() + end);
+  buffer.types.insert(buffer.types.begin() + begin, lines.types.begin(), lines.types.end());
+  buffer.offsets.erase(buffer.offsets.begin() + begin, buffer.offsets.begin() + end);
+  buffer.offsets.insert(buffer.offsets.begin() + begin, lines.offsets.begin(), lines.offsets.end());
+  buffer.lengths.erase(buffer.lengths.begin() + begin, buffer.lengths.begin() + end);
+  buffer.lengths.insert(buffer.lengths.begin() + begin, lines.lengths.begin(), lines.lengths.end());
+  buffer.numbers.erase(buffer.numbers.begin() + begin, buffer.numbers.begin() + end);
+  buffer.numbers.insert(buffer.numbers.begin() + begin, lines.numbers.begin(), lines.numbers.end());
+  buffer.symbols.erase(buffer.symbols.begin() + begin, buffer.symbols.begin() + end);
+  buffer.symbols.insert(buffer.symbols.begin() + begin, lines.symbols.begin(), lines.symbols.end());
+
+  if (tokensInStep) {
+    Tokens relexed;
+    for (u_int i = 0; i < lines.size(); ++i) {
+      relexed.push_back(lines.toToken(i));
+    }
+    tokens.erase(tokens.begin() + begin, tokens.begin() + end);
+    tokens.insert(tokens.begin() + begin, relexed.begin(), relexed.end());
+    for (u_int i = begin + relexed.size(); i < tokens.size(); ++i) {
+      tokens[i]->location += delta;
+    }
+  }
+
+  pos = src.length();
+  return { begin, end - begin, u_int(lines.size()) };
+}
+
+// Lexes the whole edited source on a lexer of its own, so a syntax error
+// leaves this one as it was. With recover, the problems of every line are
+// reported again, as after a generate.
+TokenEdit Lexer::relexAll() {
+  auto lexer = Lexer::borrow(text(), base);
+  lexer.kernels = kernels;
+  lexer.threads = threads;
+  lexer.parallelThreshold = parallelThreshold;
+  lexer.skipBlocks = skipBlocks;
+  lexer.recover = recover;
+  lexer.generateTokenBuffer();
+
+  tokensInStep = tokensInStep && tokens.size() == buffer.size();
+  if (tokensInStep) {
+    lexer.generateTokens();
+    tokens = std::move(lexer.tokens);
+  }
+
+  u_int removed = buffer.size() - 1;
+  buffer = std::move(lexer.buffer);
+  blockMap = lexer.blockMap;
+  diagnostics = std::move(lexer.diagnostics);
+  pos = text().length();
+  return { 0, removed, u_int(buffer.size() - 1) };
+}
+
+// A line without code is skipped together with its newline, but the splice
+// keeps the ENDL after the edited lines as it was. So the last edited line,
+// the one ending at the newline, has to stay a code line or stay without code.
+bool Lexer::sameCodeAt(const blocks::LineMap& before, u_int oldEnd, const blocks::LineMap& after, u_int newEnd) {
+  return blocks::isCode(before.kinds[before.line(oldEnd)]) == blocks::isCode(after.kinds[after.line(newEnd)]);
+}
+
+// lines after the edited ones, in the old and in the new source
+bool Lexer::sameKindsAfter(const blocks::LineMap& before, u_int oldEnd, const blocks::LineMap& after, u_int newEnd) {
+  auto first = before.lineAfter(oldEnd);
+  auto second = after.lineAfter(newEnd);
+  return before.size() - first == after.size() - second &&
+    std::equal(before.kinds.begin() + first, before.kinds.end(), after.kinds.begin() + second);
+}
+
+bool Lexer::useThreads() const {
+  return threads > 1 && text().length() >= parallelThreshold;
+}
+
+// Splits the source into roughly equal chunks that all start right after a
+// newline. No token spans a newline, so chunks can be lexed independently.
+std::vector<u_int> Lexer::chunkBounds() const {
+  auto src = text();
+  std::vector<u_int> bounds = { 0 };
+  u_int chunkSize = src.length() / threads + 1;
+
+  while (bounds.back() < src.length()) {
+    u_int next = bounds.back() + chunkSize;
+    if (next >= src.length()) {
+      break;
+    }
+    next += kernels->untilNewline(src.data() + next, src.length() - next) + 1;
+    if (next >= src.length()) {
+      break;
+    }
+    bounds.push_back(next);
+  }
+
+  bounds.push_back(src.length());
+  return bounds;
+}
+
+// Lexes every chunk on its own thread. A chunk lexer borrows the source up to
+// the end of its chunk, so token offsets and error positions stay in whole
+// file terms. The error of the first failing chunk is the one serial lexing
+// would have reported, so that is rethrown. Recovered diagnostics are joined
+// in chunk order.
+template <typename Output>
+std::vector<Output> Lexer::lexChunks(std::vector<u_int> bounds) {
+  auto src = text();
+  auto count = bounds.size() - 1;
+  std::vector<Output> chunks(count, Output());
+  std::vector<std::exception_ptr> errors(count);
+  std::vector<Diagnostics> recovered(count);
+  std::vector<std::thread> workers;
+
+  for (u_int i = 0; i < count; ++i) {
+    workers.emplace_back([&, i]() {
+      try {
+        auto lexer = Lexer::borrow(src.substr(0, bounds[i + 1]), base);
+        lexer.kernels = kernels;
+        lexer.blockMap = blockMap;
+        lexer.recover = recover;
+        lexer.pos = bounds[i];
+        if constexpr (std::is_same_v<Output, TokenBuffer>) {
+          chunks[i] = TokenBuffer(src, base);
+          chunks[i].table = buffer.table;
+          lexer.appendTokenBuffer(chunks[i]);
+        } else {
+          lexer.appendTokens(chunks[i]);
+        }
+        recovered[i] = std::move(lexer.diagnostics);
+      } catch (...) {
+        errors[i] = std::current_exception();
       }
-      tokens.push_back(std::make_shared<Underscore>());
-      return;
-    case '>':
-      if (peekToken == '=') {
-        tokens.push_back(std::make_shared<GtOrEquals>());
+    });
+  }
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  for (auto& chunk : recovered) {
+    diagnostics.insert(diagnostics.end(), chunk.begin(), chunk.end());
+  }
+
+  return chunks;
+}
+
+// Scans the next token starting from pos. Sets start to the first character
+// of the token and leaves pos right after it. Returns END_OF_FILE at the end.
+// Dispatch goes through the tables generated from tokenSpecs. With a
+// blockMap, lines without code are jumped over at every line start.
+TokenType Lexer::scanToken(u_int& start) {
+  auto src = text();
+  if (blockMap != nullptr && pos < src.length() && (pos == 0 || src[pos - 1] == '\n')) {
+    pos = blockMap->nextCode(pos);
+  }
+  if (pos < src.length() && src[pos] == ' ') {
+    pos += kernels->spaceRun(src.data() + pos, src.length() - pos);
+  }
+
+  start = pos;
+  if (pos >= src.length()) {
+    return TokenType::END_OF_FILE;
+  }
+
+  auto c = static_cast<unsigned char>(src[pos]);
+  auto& entry = lexer::charTable[c];
+
+  switch (entry.charClass) {
+    case lexer::CharClass::WORD:
+      scanWord();
+      return TokenType::WORD;
+    case lexer::CharClass::NUMBER:
+      return scanNumber();
+    case lexer::CharClass::OPERATOR:
+    {
+      ++pos;
+      auto& pair = lexer::pairTable[c];
+      if (pair.second != 0 && pos < src.length() && src[pos] == pair.second) {
+        if (pair.error != nullptr) {
+          auto type = fail(pair.error, start);
+          ++pos;
+          return type;
+        }
         ++pos;
-        return;
+        return pair.type;
       }
-      tokens.push_back(std::make_shared<Gt>());
-      return;
-    case '<':
-      if (peekToken == '=') {
-        tokens.push_back(std::make_shared<LtOrEquals>());
-        ++pos;
-        return;
+      return entry.type;
+    }
+    case lexer::CharClass::UTF8:
+    {
+      char32_t codePoint;
+      auto length = utf8::decode(src.data() + pos, src.length() - pos, codePoint);
+      if (length > 0 && utf8::isLetter(codePoint)) {
+        scanWord();
+        return TokenType::WORD;
       }
-      tokens.push_back(std::make_shared<Lt>());
-      return;
+      // other characters become a single token, malformed bytes one by one
+      pos += length > 0 ? length : 1;
+      return TokenType::UNDEFINED;
+    }
     default:
-      if (isLetter(c))
-        addWordToken();
-      else if (isNumber(c))
-        addNumberToken();
-      else
-        tokens.push_back(std::make_shared<Token>(std::string(1, c)));
-      return;
+      ++pos;
+      return TokenType::UNDEFINED;
   }
 }
 
-void Lexer::addWordToken() {
-  u_int startingPos = pos;
-  while (pos < source.length() && isWordLetter(source[pos])) {
-    ++pos;
-  }
-
-  std::string literal = source.substr(startingPos, pos - startingPos);
-  tokens.push_back(std::make_shared<Word>(literal));
-  --pos;
+// ASCII runs go through the vector kernels and only non-ASCII bytes are decoded
+void Lexer::scanWord() {
+  auto src = text();
+  pos += utf8::wordRun(src.data() + pos, src.length() - pos, kernels->wordRun);
 }
 
-void Lexer::addNumberToken() {
-  u_int startingPos = pos;
+TokenType Lexer::scanNumber() {
+  auto src = text();
+  auto end = pos + kernels->numberRun(src.data() + pos, src.length() - pos);
+  auto type = TokenType::NUMBER;
   u_int dots = 0;
-  while (pos < source.length() && isNumber(source[pos])) {
-    if (source[pos] == '.') {
+  for (; pos < end; ++pos) {
+    if (src[pos] == '.') {
       ++dots;
-      if (dots > 1) {
-        throw SYNTAX_ERROR("Number has more than one dot");
+      if (dots == 2) {
+        type = fail("Number has more than one dot", pos);
       }
     }
-
-    ++pos;
   }
+  return type;
+}
 
-  std::string literal = source.substr(startingPos, pos - startingPos);
-  tokens.push_back(std::make_shared<Number>(literal));
-  --pos;
+TokenType Lexer::fail(const char* msg, u_int at) {
+  if (!recover) {
+    throw SYNTAX_ERROR(msg, at);
+  }
+  diagnostics.push_back({ Diagnostic::Stage::LEXER, msg, base + at });
+  return TokenType::INVALID;
 }
 
 bool isLetter(char c) {
-  return (c >= 'a' && c <= 'z') ||
-    (c >= 'A' && c <= 'Z');
+  return scan::isLetterByte(c);
 }
 
 bool isWordLetter(char c) {
-  return isLetter(c) ||
-    isNumber(c) ||
-    c == '.' ||
-    c == '-';
+  return scan::isWordByte(c);
 }
 
 bool isNumber(char c) {
-  return (c >= '0' && c <= '9') || c == '.';
-}
\ No newline at end of file
+  return scan::isNumberByte(c);
+}
@@ -1,65 +1,120 @@
 #include "parser.h"
 
+// A declaration is followed by the scope it opens. When the declaration has
+// a problem its scope is still parsed for the problems in it, but the result
+// is left out.
+//
+// With a pool the nested scopes are started as tasks before the statements
+// of this one are parsed. They only read the scope tree and write to their
+// own Parser, call memo included, so nothing is shared but the tree. A
+// heading of the same depth as the one before it is nested in it, so the
+// tasks are mostly a chain of scopes, each parsing its own lines at the same
+// time as the others. Results are attached and diagnostics joined in source
+// order, the same as when parsed serially.
 void Parser::parseScope() {
-  pToken lastToken = nullptr;
-  for (auto t : pre->tokens) {
-    if (lastToken != nullptr && lastToken->isTypeOf(TokenType::DECLARE) && t->isTypeOf(TokenType::SCOPE)) {
-      auto decl = std::dynamic_pointer_cast<AstDeclarationStatement>(scope->statements.back());
-      auto scp = std::dynamic_pointer_cast<PreScope>(t);
-      Parser p(scp);
-      p.parseScope();
-      decl->scope = p.scope;
-    } else {
-      parseStatement(t);
+  std::vector<std::unique_ptr<Parser>> nested;
+  ThreadPool::Group group;
+  for (auto& t : pre->tokens) {
+    if (t->isTypeOf(TokenType::SCOPE)) {
+      nested.push_back(std::make_unique<Parser>(std::static_pointer_cast<PreScope>(t)));
+      auto& p = *nested.back();
+      p.pool = pool;
+      if (pool != nullptr) {
+        pool->run(group, [&p]() { p.parseScope(); });
+      }
     }
-    lastToken = t;
   }
-}
-
-void Parser::parseStatement(pToken t) {
-  scope->addStatement(createStatement(t));
-}
 
-pAstStatement Parser::createStatement(pToken t) {
-  for (auto processor : processors) {
-    if (processor->check(t)) {
-      auto error = processor->verify(t);
+  // where the diagnostics of each nested scope go in ours
+  std::vector<size_t> nestedAt;
+  pAstStatement last = nullptr;
+  for (auto& t : pre->tokens) {
+    if (t->isTypeOf(TokenType::SCOPE)) {
+      auto& p = *nested[nestedAt.size()];
+      if (pool == nullptr) {
+        p.parseScope();
+      }
+      nestedAt.push_back(diagnostics.size());
 
-      if (error == nullptr) {
-        auto stmt = std::dynamic_pointer_cast<AstStatement>(processor->create(t));
-        return stmt;
-      } else {
-        std::cerr << "Parser: tried to parse token of type " << t->literal << " but parser run to an error:\n";
-        std::cerr << "  " << error->msg << "\n";
-        std::exit(102);
+      if (auto decl = std::dynamic_pointer_cast<AstDeclarationStatement>(last)) {
+        decl->scope = p.scope;
       }
-      phrase->params.push_back(param);
+      last = nullptr;
       continue;
     }
 
-    phrase->tokens.push_back(*cur);
+    last = createStatement(t);
+    if (last != nullptr) {
+      scope->addStatement(last);
+    }
   }
 
-  return phrase;
+  if (pool != nullptr) {
+    pool->wait(group);
+  }
+  joinDiagnostics(nested, nestedAt);
 }
 
-ExprOrder Parser::curPrecedence() {
-  try {
-    return precedences.at((*cur)->type);
-  } catch (std::out_of_range e) {
-    return ExprOrder::LOWEST;
+void Parser::joinDiagnostics(const std::vector<std::unique_ptr<Parser>>& nested, const std::vector<size_t>& nestedAt) {
+  Diagnostics joined;
+  size_t from = 0;
+  for (size_t i = 0; i < nested.size(); ++i) {
+    auto& inner = nested[i]->diagnostics;
+    if (inner.empty()) {
+      continue;
+    }
+    joined.insert(joined.end(), diagnostics.begin() + from, diagnostics.begin() + nestedAt[i]);
+    joined.insert(joined.end(), inner.begin(), inner.end());
+    from = nestedAt[i];
+  }
+  if (!joined.empty()) {
+    joined.insert(joined.end(), diagnostics.begin() + from, diagnostics.end());
+    diagnostics = std::move(joined);
   }
 }
 
-ExprOrder Parser::peekPrecedence() {
-  if (cur == tokens.end() || (cur + 1) == tokens.end()) {
-    return ExprOrder::LOWEST;
+void Parser::parseStatement(pToken t) {
+  auto statement = createStatement(t);
+  if (statement != nullptr) {
+    scope->addStatement(statement);
   }
+}
 
-  try {
-    return precedences.at((*(cur + 1))->type);
-  } catch (std::out_of_range e) {
-    std::cout << "no supposed to be here\n";
-    return ExprOrder::LOWEST;
+template <typename P>
+pAstStatement Parser::parseWith(P& processor, pToken t) {
+  pParserError error;
+  auto node = processor.parse(t, error);
+
+  if (error == nullptr && node == nullptr) {
+    error = newPError("could not create " + t->typeToString());
+  }
+  if (error != nullptr) {
+    report(t, error->msg);
+    return nullptr;
   }
-}
\ No newline at end of file
+  return std::static_pointer_cast<AstStatement>(node);
+}
+
+void Parser::report(pToken t, std::string msg) {
+  diagnostics.push_back({ Diagnostic::Stage::PARSER, "Parser: " + msg, t->location });
+}
+
+pAstStatement Parser::createStatement(pToken t) {
+  if (processors.empty()) {
+    pAstStatement stmt;
+    bool accepted = statements.first([&](auto& processor) { return processor.check(t); },
+      [&](auto& processor) { stmt = parseWith(processor, t); });
+    if (!accepted) {
+      report(t, "no processor for " + t->typeToString() + " statements");
+    }
+    return stmt;
+  }
+
+  for (auto processor : processors) {
+    if (processor->check(t)) {
+      return parseWith(*processor, t);
+    }
+  }
+  report(t, "no processor for " + t->typeToString() + " statements");
+  return nullptr;
+}
@@ -4,109 +4,169 @@
 
 void PreParser::prepareFromStart()
 {
-    parsedTokens.push_back(std::make_shared<PreBlock>());
+    openRoot();
     prepare(tokens.begin());
 }
 
+// Pulls tokens from the lexer with next() and prepares them a line at a
+// time. The line table and the processors index into the tokens of a line,
+// so each line is still buffered in tokens, up to and with its END token.
+// Only the vector for the whole source never exists, the lexer's peek()
+// lookahead is not used.
+void PreParser::prepareFromLexer(Lexer& lexer)
+{
+    openRoot();
+
+    bool endOfFile = false;
+    while (!endOfFile)
+    {
+        tokens.clear();
+        do
+        {
+            tokens.push_back(lexer.next());
+        } while (!tokens.back()->isTypeOf(token::END));
+
+        endOfFile = tokens.back()->isTypeOf(TokenType::END_OF_FILE);
+        auto it = tokens.begin();
+        prepareStatements(it);
+    }
+
+    scoped = builder.root;
+}
+
+// Statements go into the scope tree as they are prepared, so the tree and
+// its identifiers are ready after one sweep over the tokens.
 void PreParser::prepare(Tokens::iterator it)
 {
     prepareStatements(it);
-    flattenDeclarations();
-    prepareScopeTree(parsedTokens.begin());
-    gatherIdentifiers();
+    scoped = builder.root;
 }
 
+void PreParser::openRoot()
+{
+    diagnostics.clear();
+    statementAt = NO_LOCATION;
+    auto block = arena->make<PreBlock>();
+    parsedTokens.push_back(block);
+    builder = ScopeBuilder(arena.get());
+    builder.open(block->depth);
+}
+
+void PreParser::addStatement(pToken statement)
+{
+    parsedTokens.push_back(statement);
+    if (!builder.add(statement))
+    {
+        report("Scope: " + statement->typeToString() + " without an identifier");
+    }
+
+    // the block opened by a declaration is listed after it
+    if (statement->isTypeOf(TokenType::DECLARE))
+    {
+        auto block = arena->make<PreBlock>();
+        block->depth = builder.current->depth;
+        parsedTokens.push_back(block);
+    }
+}
+
+// Lines are classified once into a line table and each statement is handed
+// to the first processor that accepts its line, so no processor scans a line
+// just to find out that it is not its case.
 void PreParser::prepareStatements(Tokens::iterator &it)
 {
-    while (it != tokens.end() && !(*it)->isTypeOf(TokenType::END_OF_FILE))
+    u_int end = std::distance(tokens.begin(), it);
+    for (auto& line : preprocessor::lineTable(tokens, end))
     {
-        for (auto processor : processors)
+        end = line.end;
+        // the lexer has reported what is wrong with the line
+        if (line.invalid != LineInfo::NONE)
         {
-            if (processor->check(tokens, it))
+            continue;
+        }
+
+        // a line can hold more than one statement when a processor stops
+        // early, the rest is classified from where it stopped
+        auto info = line;
+        while (info.start < line.end)
+        {
+            prepareStatement(info);
+            if (info.start < line.end)
             {
-                auto error = processor->verify(tokens, it);
-                if (error == nullptr)
-                {
-                    parsedTokens.push_back(processor->create(tokens, it));
-                    break;
-                }
-                else
-                {
-                    std::cerr << "Preprocessor error: " << error->msg << "\n";
-                    std::exit(100);
-                }
+                info = preprocessor::classifyLine(tokens, info.start);
             }
         }
-        it = std::next(it);
     }
+    it = tokens.begin() + end;
 }
 
-void PreParser::flattenDeclarations()
+// Prepares the statement at the start of line and moves the start past it.
+// When the statement has a problem it is reported and the rest of the line
+// is skipped, the next line starts a statement of its own.
+void PreParser::prepareStatement(LineInfo& line)
 {
-    Tokens computed = {};
-    auto it = parsedTokens.begin();
-    while (it != parsedTokens.end())
+    auto it = tokens.begin() + line.start;
+    statementAt = (*it)->location;
+    bool accepted = false;
+    bool prepared = false;
+    auto accepts = [&](auto& processor) { return processor.check(tokens, line); };
+    auto prepare = [&](auto& processor) { prepared = prepareWith(processor, it); };
+
+    if (processors.empty())
     {
-        if ((*it)->isTypeOf(TokenType::DECLARE))
-        {
-            auto def = std::dynamic_pointer_cast<PreDeclare>(*it);
-            auto block = std::make_shared<PreBlock>();
-            block->depth = def->depth;
-            computed.push_back(def);
-            computed.push_back(block);
-        }
-        else
+        accepted = statements.first(accepts, prepare);
+    }
+    else
+    {
+        for (auto& processor : processors)
         {
-            computed.push_back(*it);
+            if (accepts(*processor))
+            {
+                prepare(*processor);
+                accepted = true;
+                break;
+            }
         }
-        it = std::next(it);
     }
-    parsedTokens = computed;
-}
 
-void PreParser::prepareScopeTree(Tokens::iterator it)
-{
-    ScopeBuilder builder = ScopeBuilder();
-    builder.build(parsedTokens);
-    scoped = builder.root;
+    if (!accepted)
+    {
+        report("Preprocessor error: unexpected " + tokens[line.start]->typeToString());
+    }
+    if (!prepared)
+    {
+        line.start = line.end + 1;
+        return;
+    }
+    line.start = std::distance(tokens.begin(), it) + 1;
 }
 
-void PreParser::gatherIdentifiers()
+void PreParser::report(std::string msg)
 {
-    gatherIdentifiersForScope(scoped);
+    diagnostics.push_back({ Diagnostic::Stage::PREPARSER, msg, statementAt });
 }
 
-void PreParser::gatherIdentifiersForScope(pPreScope scope)
+template <typename P>
+bool PreParser::prepareWith(P& processor, Tokens::iterator& it)
 {
-    for (auto t : scope->tokens)
-    {
-        switch (t->type)
-        {
-        case TokenType::SCOPE:
-        {
-            gatherIdentifiersForScope(std::dynamic_pointer_cast<PreScope>(t));
-            break;
-        }
-        case TokenType::DECLARE:
-        {
-            auto decl = std::dynamic_pointer_cast<PreDeclare>(t);
+    std::shared_ptr<PreProcessorError> error;
+    auto token = processor.parse(tokens, it, error);
 
-            while (decl->depth <= scope->depth)
-            {
-                scope = scope->broader;
-            }
-
-            scope->addIdentifier(decl->tokens[0]);
-            break;
-        }
-        case TokenType::ASSIGNMENT:
-        {
-            auto assign = std::dynamic_pointer_cast<PreAssignment>(t);
-            scope->addIdentifier(assign->tokens[0]);
-            break;
-        }
-        default:
-            break;
-        }
+    if (error == nullptr && token == nullptr)
+    {
+        error = std::make_shared<PreProcessorError>("could not create the statement");
+    }
+    if (error != nullptr)
+    {
+        report("Preprocessor error: " + error->msg);
+        return false;
     }
-}
\ No newline at end of file
+    token->location = statementAt;
+    addStatement(token);
+    return true;
+}
+
+void PreParser::addProcessor(std::shared_ptr<PreProcessor> processor)
+{
+    processor->arena = arena.get();
+    processors.push_back(processor);
+}
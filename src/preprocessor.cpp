@@ -2,100 +2,112 @@
 #include <algorithm>
 #include <iostream>
 
-bool PreProcessor::separateLine(Tokens& t, Tokens::iterator& begin, std::vector<TokenType> end) {
-    line = {};
-    auto endIt = std::find_if(begin, t.end(), [end](pToken token) { return token->isTypeOf(end); });
-    line.assign(begin, endIt);
+LineInfo preprocessor::classifyLine(const Tokens& t, u_int start) {
+    LineInfo line;
+    line.start = start;
 
-    return endIt != t.end();
+    auto i = start;
+    while (i < t.size() && t[i]->type == TokenType::HASH) {
+        ++i;
+    }
+    line.depth = i - start;
+
+    // an import at the start of the line is `[`, up to the first `]`, then `(`
+    bool inBrackets = i == start && i < t.size() && t[i]->type == TokenType::LBRACKET;
+    for (; i < t.size() && !t[i]->isTypeOf(token::END); ++i) {
+        auto type = t[i]->type;
+        if (type == TokenType::EQUALS && line.equals == LineInfo::NONE) {
+            line.equals = i;
+        }
+        if (type == TokenType::INVALID && line.invalid == LineInfo::NONE) {
+            line.invalid = i;
+        }
+        if (inBrackets && type == TokenType::RBRACKET) {
+            line.import = i + 1 < t.size() && t[i + 1]->type == TokenType::LBRACE;
+            inBrackets = false;
+        }
+    }
+    line.end = i;
+    return line;
+}
+
+LineTable preprocessor::lineTable(const Tokens& t, u_int start) {
+    LineTable table;
+    while (start < t.size() && t[start]->type != TokenType::END_OF_FILE) {
+        table.push_back(classifyLine(t, start));
+        start = table.back().end + 1;
+    }
+    return table;
 }
 
 bool DefinitionProcessor::check(Tokens& t, Tokens::iterator it) {
     return (*it)->isTypeOf(TokenType::HASH);
 }
 
-std::shared_ptr<PreProcessorError> DefinitionProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto hashCount = preprocessor::expectMultiple(it, { TokenType::HASH });
+bool DefinitionProcessor::check(Tokens& t, const LineInfo& line) {
+    return line.depth > 0;
+}
+
+std::shared_ptr<PreToken> DefinitionProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto depth = preprocessor::expectMultiple(it, t.end(), { TokenType::HASH });
 
-    if (hashCount == -1) {
-        return std::make_shared<PreProcessorError>("Definition: hash symbols not found.");
+    if (depth == -1) {
+        error = preprocessor::error("Definition: hash symbols not found.");
+        return nullptr;
     }
 
-    if (hashCount == 0) {
-        return std::make_shared<PreProcessorError>("Definition must start with #");
+    if (depth == 0) {
+        error = preprocessor::error("Definition must start with #");
+        return nullptr;
     }
 
-    DeclarationIdentifierProcessor idProcessor;
-    auto error = idProcessor.verify(t, it);
+    auto idProcessor = part(DeclarationIdentifierProcessor());
+    auto identifier = idProcessor.parse(t, it, error);
     if (error) {
         error->msg = "Definition: " + error->msg;
-        return error;
+        return nullptr;
     }
-    return nullptr;
-}
 
-std::shared_ptr<PreToken> DefinitionProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto token = std::make_shared<PreDeclare>();
-    auto scope = std::make_shared<PreBlock>();
-
-    auto depth = preprocessor::expectMultiple(it, { TokenType::HASH });
+    auto token = make<PreDeclare>();
     token->depth = depth;
-
-    DeclarationIdentifierProcessor idProcessor;
-    token->tokens.push_back(idProcessor.create(t, it));
+    token->tokens.push_back(identifier);
     return token;
 }
 
 bool AssignmentProcessor::check(Tokens& t, Tokens::iterator it) {
-    auto count = preprocessor::fastForwardUntil(it, { TokenType::EQUALS });
+    auto count = preprocessor::fastForwardUntil(it, t.end(), { TokenType::EQUALS });
     return count != -1;
 }
 
-std::shared_ptr<PreProcessorError> AssignmentProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto ip = DeclarationIdentifierProcessor();
-    ip.endsWith = { TokenType::EQUALS };
-    auto idError = ip.verify(t, it);
-
-    if (idError) {
-        return idError;
-    }
+bool AssignmentProcessor::check(Tokens& t, const LineInfo& line) {
+    return line.equals != LineInfo::NONE;
+}
 
-    it = t.begin() + ip.endPosition;
+std::shared_ptr<PreToken> AssignmentProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto ip = part(DeclarationIdentifierProcessor());
+    ip.setEndsWith({ TokenType::EQUALS });
+    auto idToken = ip.parse(t, it, error);
 
-    if (!(*it)->isTypeOf({ TokenType::EQUALS })) {
-        return preprocessor::error("Assignment: Identifier should end with Equals sign");
+    if (error) {
+        return nullptr;
     }
 
+    // equals sign
     it = std::next(it);
 
     if ((*it)->isTypeOf(token::END)) {
-        return preprocessor::error("Assignment: Cannot assign empty");
+        error = preprocessor::error("Assignment: Cannot assign empty");
+        return nullptr;
     }
 
-    auto ep = ExpressionProcessor();
-    auto expError = ep.verify(t, it);
+    auto ep = part(ExpressionProcessor());
+    auto expressionToken = ep.parse(t, it, error);
 
-    if (expError) {
-        return expError;
+    if (error) {
+        return nullptr;
     }
 
-    it = t.begin() + ep.endPosition;
-    return nullptr;
-}
-
-std::shared_ptr<PreToken> AssignmentProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto assignToken = std::make_shared<PreAssignment>();
-
-    auto ip = DeclarationIdentifierProcessor();
-    ip.setEndsWith({ TokenType::EQUALS });
-    auto idToken = ip.create(t, it);
-
-    // equals sign
-    it = std::next(it);
-
-    auto ep = ExpressionProcessor();
-    auto expressionToken = ep.create(t, it);
-
+    auto assignToken = make<PreAssignment>();
     assignToken->tokens.push_back(idToken);
     assignToken->tokens.push_back(expressionToken);
     return assignToken;
@@ -106,76 +118,71 @@ bool ImportProcessor::check(Tokens& t, Tokens::iterator it) {
         return false;
     }
 
-    if (preprocessor::fastForwardUntil(it, { TokenType::RBRACKET }) == -1) {
+    if (preprocessor::fastForwardUntil(it, t.end(), { TokenType::RBRACKET }) == -1) {
         return false;
     }
 
-    return preprocessor::expect(it, { TokenType::LBRACE });
+    return preprocessor::expect(it, t.end(), { TokenType::LBRACE });
+}
+
+bool ImportProcessor::check(Tokens& t, const LineInfo& line) {
+    return line.import;
 }
 
-std::shared_ptr<PreProcessorError> ImportProcessor::verify(Tokens& t, Tokens::iterator it) {
+std::shared_ptr<PreToken> ImportProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
     if (!(*it)->isTypeOf(TokenType::LBRACKET)) {
-        return preprocessor::error("Import: Should start with [");
+        error = preprocessor::error("Import: Should start with [");
+        return nullptr;
     }
 
-    if (preprocessor::fastForwardUntil(it, { TokenType::RBRACKET }) == -1) {
-        return preprocessor::error("Import: Closing bracket is missing.");
+    // bypass description for now. It would be convenient to have access in import description later on.
+    if (preprocessor::fastForwardUntil(it, t.end(), { TokenType::RBRACKET }) == -1) {
+        error = preprocessor::error("Import: Closing bracket is missing.");
+        return nullptr;
     }
 
-    if (!preprocessor::expect(it, { TokenType::LBRACE })) {
-        return preprocessor::error("Import: Unexpected token after brackets: " + (*it)->literal);
+    if (!preprocessor::expect(it, t.end(), { TokenType::LBRACE })) {
+        error = preprocessor::error("Import: Unexpected token after brackets: " + (*it)->literal);
+        return nullptr;
     }
 
-    it = std::next(it);
-    auto linkCount = preprocessor::fastForwardUntil(it, { TokenType::RBRACE });
-
-    if (linkCount == -1) {
-        return preprocessor::error("Import: Closing brace is missing.");
-    }
-
-    if (linkCount == 0) {
-        return preprocessor::error("Import: Link should not be empty");
-    }
-
-    endPosition = std::distance(t.begin(), it);
-    return nullptr;
-}
-
-std::shared_ptr<PreToken> ImportProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto importToken = std::make_shared<PreImport>();
-
-    preprocessor::expect(it, { TokenType::LBRACKET });
-
-    while (!(*it)->isTypeOf(TokenType::RBRACKET)) {
-        it = std::next(it);
-        // bypass description for now. It would be convenient to have access in import description later on.
-    }
-
-    preprocessor::expect(it, { TokenType::LBRACE });
+    auto importToken = make<PreImport>();
     it = std::next(it);
 
     while (!(*it)->isTypeOf(TokenType::RBRACE)) {
+        if ((*it)->isTypeOf(token::END)) {
+            error = preprocessor::error("Import: Closing brace is missing.");
+            return nullptr;
+        }
         importToken->tokens.push_back(*it);
         it = std::next(it);
     }
 
+    if (importToken->tokens.empty()) {
+        error = preprocessor::error("Import: Link should not be empty");
+        return nullptr;
+    }
+
     return importToken;
 }
 
 bool ExpressionStatementProcessor::check(Tokens& t, Tokens::iterator it) {
-    auto ep = ExpressionProcessor();
-    return ep.check(t, it);
+    return (*it)->isTypeOf(ExpressionProcessor::expressionTokens);
 }
 
-std::shared_ptr<PreProcessorError> ExpressionStatementProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto ep = ExpressionProcessor();
-    return ep.verify(t, it);
+bool ExpressionStatementProcessor::check(Tokens& t, const LineInfo& line) {
+    return t[line.start]->isTypeOf(ExpressionProcessor::expressionTokens);
 }
 
-std::shared_ptr<PreToken> ExpressionStatementProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto expressionStatement = std::make_shared<PreExpressionStatement>();
-    auto ep = ExpressionProcessor();
-    expressionStatement->tokens.push_back(ep.create(t, it));
+std::shared_ptr<PreToken> ExpressionStatementProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto ep = part(ExpressionProcessor());
+    auto expression = ep.parse(t, it, error);
+    if (error) {
+        return nullptr;
+    }
+
+    auto expressionStatement = make<PreExpressionStatement>();
+    expressionStatement->tokens.push_back(expression);
     return expressionStatement;
 }
 
@@ -186,58 +193,33 @@ bool ExpressionProcessor::check(Tokens& t, Tokens::iterator it) {
     return false;
 }
 
-std::shared_ptr<PreProcessorError> ExpressionProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto ip = ImportProcessor();
-    auto ident = IdentifierProcessor();
+std::shared_ptr<PreToken> ExpressionProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto et = make<PreExpression>();
+    auto ip = part(ImportProcessor());
+    auto ident = part(IdentifierProcessor());
 
     while (!(*it)->isTypeOf(endsWith)) {
         if (!check(t, it)) {
-            return std::make_shared<PreProcessorError>("Expression: Illigal symbol: " + (*it)->literal);
+            error = preprocessor::error("Expression: Illigal symbol: " + (*it)->literal);
+            return nullptr;
         }
 
         if (ident.check(t, it)) {
-            auto error = ident.verify(t, it);
-            if (error != nullptr) {
-                error->msg = "Expression: " + error->msg;
-                return error;
-            }
-            it = t.begin() + ident.endPosition;
-            continue;
-        }
-
-        if (ip.check(t, it)) {
-            auto error = ip.verify(t, it);
-            if (error != nullptr) {
-                error->msg = "Expression: " + error->msg;
-                return error;
-            }
-            it = t.begin() + ip.endPosition;
-            continue;
-        }
-        it = std::next(it);
-    }
-
-    endPosition = std::distance(t.begin(), it);
-    return nullptr;
-}
-
-std::shared_ptr<PreToken> ExpressionProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto et = std::make_shared<PreExpression>();
-    auto ip = ImportProcessor();
-    auto ident = IdentifierProcessor();
-
-    while (!(*it)->isTypeOf(endsWith)) {
-        if (ip.check(t, it)) {
-            et->tokens.push_back(ip.create(t, it));
-        } else if (ident.check(t, it)) {
-            et->tokens.push_back(ident.create(t, it));
-            continue;
+            et->tokens.push_back(ident.parse(t, it, error));
+        } else if (ip.check(t, it)) {
+            et->tokens.push_back(ip.parse(t, it, error));
+            it = std::next(it);
         } else {
             et->tokens.push_back(*it);
+            it = std::next(it);
         }
 
-        it = std::next(it);
+        if (error) {
+            error->msg = "Expression: " + error->msg;
+            return nullptr;
+        }
     }
+
     return et;
 }
 
@@ -245,134 +227,76 @@ bool IdentifierProcessor::check(Tokens& t, Tokens::iterator it) {
     return (*it)->isTypeOf({ TokenType::WORD, TokenType::UNDERSCORE });
 }
 
-std::shared_ptr<PreProcessorError> IdentifierProcessor::verifyIdentifier(Tokens& t, Tokens::iterator it, std::shared_ptr<ParameterProcessor> pp) {
+std::shared_ptr<PreToken> IdentifierProcessor::parseIdentifier(Tokens& t, Tokens::iterator& it, ParameterProcessor& pp, std::shared_ptr<PreProcessorError>& error) {
+    auto token = make<PreIdentifier>();
+
     while (!(*it)->isTypeOf(endsWith)) {
         if (!check(t, it)) {
-            return preprocessor::error("unexpected token: " + (*it)->typeToString());
+            error = preprocessor::error("unexpected token: " + (*it)->typeToString());
+            return nullptr;
         }
 
-        if (pp->check(t, it)) {
-            auto error = pp->verify(t, it);
-
+        if (pp.check(t, it)) {
+            auto parameter = pp.parse(t, it, error);
             if (error) {
                 error->msg = "Parameter: " + error->msg;
-                return error;
+                return nullptr;
             }
-
-            it = t.begin() + pp->endPosition;
-        }
-
-        it = std::next(it);
-    }
-
-    endPosition = std::distance(t.begin(), it);
-    return nullptr;
-}
-
-std::shared_ptr<PreToken> IdentifierProcessor::createIdentifier(Tokens& t, Tokens::iterator& it, std::shared_ptr<ParameterProcessor> pp) {
-    auto token = std::make_shared<PreIdentifier>();
-
-    while (!(*it)->isTypeOf(endsWith)) {
-        if (pp->check(t, it)) {
-            token->tokens.push_back(pp->create(t, it));
+            token->tokens.push_back(parameter);
         } else {
             token->tokens.push_back(*it);
         }
         it = std::next(it);
     }
-    return token;
-}
-
-std::shared_ptr<PreProcessorError> IdentifierProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto pp = std::make_shared<ActualParameterProcessor>();
-    return verifyIdentifier(t, it, pp);
-}
 
-std::shared_ptr<PreToken> IdentifierProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto pp = std::make_shared<ActualParameterProcessor>();
-    return createIdentifier(t, it, pp);
+    return token;
 }
 
-
-std::shared_ptr<PreProcessorError> DeclarationIdentifierProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto pp = std::make_shared<FormalParameterProcessor>();
-    return verifyIdentifier(t, it, pp);
+std::shared_ptr<PreToken> IdentifierProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto pp = part(ActualParameterProcessor());
+    return parseIdentifier(t, it, pp, error);
 }
 
-std::shared_ptr<PreToken> DeclarationIdentifierProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto pp = std::make_shared<FormalParameterProcessor>();
-    return createIdentifier(t, it, pp);
+std::shared_ptr<PreToken> DeclarationIdentifierProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto pp = part(FormalParameterProcessor());
+    return parseIdentifier(t, it, pp, error);
 }
 
-
 bool ParameterProcessor::check(Tokens& t, Tokens::iterator it) {
     return (*it)->isTypeOf(TokenType::UNDERSCORE);
 }
 
-std::shared_ptr<PreProcessorError> ParameterProcessor::verifyParameter(Tokens& t, Tokens::iterator& it) {
-    if (!check(t, it)) {
-        return preprocessor::error("Parameter: Should start with underscore");
-    }
-
+std::shared_ptr<PreToken> ParameterProcessor::parseParameter(Tokens& t, Tokens::iterator& it, ComponentProcessor& cp, std::shared_ptr<PreProcessorError>& error) {
     it = std::next(it);
 
     if ((*it)->isTypeOf(TokenType::UNDERSCORE)) {
-        return preprocessor::error("Parameter: parameter is missing");
-    }
-
-    while (!(*it)->isTypeOf(TokenType::UNDERSCORE)) {
-        if ((*it)->isTypeOf(token::END)) {
-            return preprocessor::error("Parameter: enclosing underscore is missing");
-        }
-
-        it = std::next(it);
+        error = preprocessor::error("parameter is missing");
+        return nullptr;
     }
 
-    endPosition = std::distance(t.begin(), it);
-    return nullptr;
-}
-
-std::shared_ptr<PreToken> ParameterProcessor::createParameter(Tokens& t, Tokens::iterator& it, std::shared_ptr<ComponentProcessor> cp) {
-    it = std::next(it);
-    auto token = std::make_shared<PreParameter>();
-
-    cp->endsWith = { TokenType::UNDERSCORE };
-
-    token->tokens.push_back(cp->create(t, it));
-    endPosition = std::distance(t.begin(), it);
-    return token;
-}
-
-std::shared_ptr<PreProcessorError> ActualParameterProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto error = verifyParameter(t, it);
+    auto component = cp.parse(t, it, error);
     if (error) {
-        return error;
+        return nullptr;
     }
 
-    auto ep = ExpressionProcessor();
-    ep.endsWith = { TokenType::UNDERSCORE };
-    return ep.verify(t, it);
-}
-
-std::shared_ptr<PreToken> ActualParameterProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto ep = std::make_shared<ExpressionProcessor>();
-    return createParameter(t, it, ep);
-}
-
-std::shared_ptr<PreProcessorError> FormalParameterProcessor::verify(Tokens& t, Tokens::iterator it) {
-    auto error = verifyParameter(t, it);
-    if (error) {
-        return error;
+    if (!(*it)->isTypeOf(TokenType::UNDERSCORE)) {
+        error = preprocessor::error("enclosing underscore is missing");
+        return nullptr;
     }
 
-    IdentifierProcessor ip;
-    ip.endsWith = { TokenType::UNDERSCORE };
-    return ip.verify(t, it);
+    auto token = make<PreParameter>();
+    token->tokens.push_back(component);
+    return token;
 }
 
-std::shared_ptr<PreToken> FormalParameterProcessor::create(Tokens& t, Tokens::iterator& it) {
-    auto ip = std::make_shared<IdentifierProcessor>();
-    ip->endsWith = { TokenType::UNDERSCORE };
-    return createParameter(t, it, ip);
+std::shared_ptr<PreToken> ActualParameterProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto ep = part(ExpressionProcessor());
+    ep.endsWith = token::END | TokenType::UNDERSCORE;
+    return parseParameter(t, it, ep, error);
 }
 
+std::shared_ptr<PreToken> FormalParameterProcessor::parse(Tokens& t, Tokens::iterator& it, std::shared_ptr<PreProcessorError>& error) {
+    auto ip = part(IdentifierProcessor());
+    ip.endsWith = token::END | TokenType::UNDERSCORE;
+    return parseParameter(t, it, ip, error);
+}
@@ -1,266 +1,205 @@
+#include <charconv>
 #include "processor.h"
 
-pParserError ExpressionStatementProc::verify(pToken t) {
+pAstNode ExpressionStatementProc::parse(pToken t, pParserError& error) {
   if (!check(t)) {
-    return newPError("ExpressionStatement: Pre-processed token is wrong type: " + t->typeToString());
+    error = newPError("ExpressionStatement: Pre-processed token is wrong type: " + t->typeToString());
+    return nullptr;
+  }
+  auto est = std::static_pointer_cast<PreExpressionStatement>(t);
+  if (est->tokens.empty()) {
+    error = newPError("ExpressionStatement: expression is missing");
+    return nullptr;
   }
-  auto est = std::dynamic_pointer_cast<PreExpressionStatement>(t);
-
-  auto exprProcessor = ExpressionProc(scope);
-  return exprProcessor.verifyTokens(est->tokens);
-}
 
-pAstNode ExpressionStatementProc::create(pToken t) {
-  auto est = std::dynamic_pointer_cast<PreExpressionStatement>(t);
-  auto exprToken = est->tokens.front();
-  auto exprProcessor = ExpressionProc(scope);
-  auto stmt = std::make_shared<AstExpressionStatement>(t, std::dynamic_pointer_cast<AstExpression>(exprProcessor.create(exprToken)));
-  return stmt;
+  auto exprProcessor = ExpressionProc(scope, calls);
+  auto expression = exprProcessor.parse(est->tokens.front(), error);
+  if (error != nullptr) {
+    return nullptr;
+  }
+  return std::make_shared<AstExpressionStatement>(t, std::static_pointer_cast<AstExpression>(expression));
 }
 
 
-pParserError ExpressionProc::verify(pToken t) {
+pAstNode ExpressionProc::parse(pToken t, pParserError& error) {
   if (!check(t)) {
-    return newPError("Expression Processor: Wrong pre-processor token " + t->typeToString());
+    error = newPError("Expression Processor: Wrong pre-processor token " + t->typeToString());
+    return nullptr;
   }
 
-  auto expr = std::dynamic_pointer_cast<PreExpression>(t);
-  pToken lastToken = nullptr;
-
-  for (auto it = expr->tokens.begin(); it != expr->tokens.end(); ++it) {
-    pToken tt = *it;
-    if (lastToken == nullptr) {
-      if (tt->isTypeOf(prefixTypes)) {
-        lastToken = tt;
-        continue;
-      }
-
-      if (tt->isTypeOf(callTypes)) {
-
-        auto callProc = CallProc(scope);
-        auto foundCall = callProc.checkLine(expr->tokens, it);
-
-        if (foundCall) {
-          lastToken = tt;
-          continue;
-        } else {
-          return newPError("Expression Processor: unknown identifier: " + tt->verboseToken());
-        }
-      }
-
-      return newPError("Expression Processor: Expected prefix token or identifier but got "
-        + tt->typeToString() +
-        ", literal: " + tt->literal);
-
+  src = TokenSpan(std::static_pointer_cast<PreExpression>(t)->tokens);
+  cur = src.begin();
+  this->error = nullptr;
+
+  auto expression = parseExpression(ExprOrder::LOWEST);
+
+  // whatever parseExpression left over does not continue the expression
+  if (this->error == nullptr && cur + 1 < src.end()) {
+    auto last = *cur;
+    auto unexpected = *(cur + 1);
+    if (last->isTypeOf(TokenType::NUMBER) && unexpected->isTypeOf(TokenType::NUMBER)) {
+      fail("Expression Processor: unexpected two numbers in a row " + last->literal + " and " + unexpected->literal);
+    } else if (last->isTypeOf(TokenType::IDENTIFIER) && unexpected->isTypeOf(TokenType::IDENTIFIER)) {
+      fail("Expression Processor: unexpected two identifiers in a row "
+        + last->verboseToken() + " and " + unexpected->verboseToken());
     } else {
-      if (lastToken->isTypeOf(infixTypes) && tt->isTypeOf(infixTypes) && !tt->isTypeOf(TokenType::MINUS)) {
-        return newPError("Expression Processor: unexpected two infix types in a row "
-          + lastToken->typeToString() + " and " + tt->typeToString());
-      }
-
-      if (lastToken->isTypeOf(TokenType::NUMBER) && tt->isTypeOf(TokenType::NUMBER)) {
-        return newPError("Expression Processor: unexpected two numbers in a row "
-          + lastToken->literal + " and " + tt->literal);
-      }
-
-      if (tt->isTypeOf(callTypes)) {
-        if (lastToken->isTypeOf(TokenType::IDENTIFIER)) {
-          return newPError("Expression Processor: unexpected two identifiers in a row "
-            + lastToken->verboseToken() + " and " + tt->verboseToken());
-        }
-
-        auto callProc = CallProc(scope);
-        auto callFound = callProc.checkLine(expr->tokens, it);
-
-        if (callFound > 0) {
-          lastToken = tt;
-          it = std::next(it);
-          continue;
-        } else {
-          return newPError("Expression Processor: unknown identifier: " + tt->verboseToken());
-        }
-      }
+      fail("Expression Processor: unexpected " + unexpected->typeToString() + " after " + last->typeToString());
     }
-
-    lastToken = tt;
   }
 
-  return nullptr;
-}
-
-pAstNode ExpressionProc::create(pToken t) {
-  auto exprToken = std::dynamic_pointer_cast<PreExpression>(t);
-  src = exprToken->tokens;
-  cur = src.begin();
-
-  return parseExpression(ExprOrder::LOWEST);
+  error = this->error;
+  return error == nullptr ? expression : nullptr;
 }
 
+// Precedence climbing over src. Binding powers come from the token spec
+// table, where everything that is not an infix operator binds LOWEST and so
+// ends the loop. Problems are recorded in error, which stops the parse.
 std::shared_ptr<AstExpression> ExpressionProc::parseExpression(ExprOrder precedence) {
-  std::shared_ptr<AstExpression> leftExp;
+  if (cur == src.end()) {
+    return fail("Expression Processor: expression ends unexpectedly");
+  }
 
-  auto callProc = CallProc(scope);
+  std::shared_ptr<AstExpression> leftExp;
 
-  if (callProc.checkLine(src, cur)) {
-    leftExp = callProc.create(src, cur);
-  } else {
-    switch ((*cur)->type) {
-      case TokenType::NUMBER:
-      {
-        leftExp = parseNumberLiteral();
-        break;
-      }
-      case TokenType::BANG:
-      case TokenType::MINUS:
-      {
-        leftExp = parsePrefixExpression();
-        break;
+  switch ((*cur)->type) {
+    case TokenType::IDENTIFIER:
+    {
+      auto callProc = CallProc(scope, calls);
+      if (!callProc.checkLine(src, cur)) {
+        return fail("Expression Processor: unknown identifier: " + (*cur)->verboseToken());
       }
-      default:
-        // this is an critical error
-        std::cerr << "Expression: Critical error: No prefix processor found for type: "
-          << tokenTypeToString[(*cur)->type] << "\n";
-        std::exit(103);
+      leftExp = std::make_shared<AstCall>(*cur, std::static_pointer_cast<PreIdentifier>(*cur));
+      break;
     }
+    case TokenType::NUMBER:
+    {
+      leftExp = parseNumberLiteral();
+      break;
+    }
+    case TokenType::BANG:
+    case TokenType::MINUS:
+    {
+      leftExp = parsePrefixExpression();
+      break;
+    }
+    default:
+      return fail("Expression Processor: Expected prefix token or identifier but got "
+        + (*cur)->typeToString() + ", literal: " + (*cur)->literal);
   }
 
-  for (;cur != src.end() && (cur + 1) != src.end() && precedence < peekPrecedence();) {
-    auto peek = *(cur + 1);
-    if (peek->isTypeOf(infixTypes)) {
-      next();
-      leftExp = parseInfixExpression(leftExp);
-      continue;
-    } else {
-      std::cerr << "did not recognize infix type: " << peek->typeToString() << "\n";
-    }
-    return leftExp;
+  while (leftExp != nullptr && precedence < peekPrecedence()) {
+    next();
+    leftExp = parseInfixExpression(leftExp);
   }
 
   return leftExp;
 }
 
 std::shared_ptr<AstExpression> ExpressionProc::parseNumberLiteral() {
-  return std::make_shared<AstNumber>((*cur), std::stod((*cur)->literal));
+  auto& literal = (*cur)->literal;
+  double value = 0;
+  auto parsed = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+  if (parsed.ec != std::errc() || parsed.ptr != literal.data() + literal.size()) {
+    return fail("Expression Processor: malformed number " + literal);
+  }
+  return std::make_shared<AstNumber>((*cur), value);
 }
 
 std::shared_ptr<AstExpression> ExpressionProc::parsePrefixExpression() {
-  auto prefixExpression = std::make_shared<AstPrefixExpression>();
-  prefixExpression->token = *cur;
+  auto token = *cur;
   next();
-  prefixExpression->right = parseExpression(ExprOrder::PREFIX);
-  return prefixExpression;
+  auto right = parseExpression(ExprOrder::PREFIX);
+  return right != nullptr ? std::make_shared<AstPrefixExpression>(token, right) : nullptr;
 }
 
 std::shared_ptr<AstExpression> ExpressionProc::parseInfixExpression(std::shared_ptr<AstExpression> leftExp) {
-  auto infixExpression = std::make_shared<AstInfixExpression>();
-  infixExpression->left = leftExp;
-  infixExpression->token = *cur;
+  auto token = *cur;
   auto precedence = curPrecedence();
   next();
-  infixExpression->right = parseExpression(precedence);
-  return infixExpression;
+  auto right = parseExpression(precedence);
+  return right != nullptr ? std::make_shared<AstInfixExpression>(token, leftExp, right) : nullptr;
 }
 
-pParserError DeclarationProc::verify(pToken t) {
-  auto decl = std::dynamic_pointer_cast<PreDeclare>(t);
-  auto tokens = decl->tokens;
-  if (tokens.size() != 1) {
-    return newPError("Declaration: Identifier is missing: " + t->verboseToken());
+pAstNode DeclarationProc::parse(pToken t, pParserError& error) {
+  auto decl = std::static_pointer_cast<PreDeclare>(t);
+  if (decl->tokens.size() != 1) {
+    error = newPError("Declaration: Identifier is missing: " + t->verboseToken());
+    return nullptr;
   }
 
-  auto idProc = IdentifierProc(scope);
-  return idProc.verify(tokens[0]);
-}
-
-pAstNode DeclarationProc::create(pToken t) {
-  auto idProc = IdentifierProc(scope);
-  auto decl = std::dynamic_pointer_cast<PreDeclare>(t);
-  auto tokens = decl->tokens;
-  // unfortunately declaration block needs to be handled in upper level (effectively in Parser loop).
-  return std::make_shared<AstDeclarationStatement>(t, std::dynamic_pointer_cast<AstIdentifier>(idProc.create(tokens[0])));
+  auto idProc = IdentifierProc(scope, calls);
+  auto identifier = idProc.parse(decl->tokens[0], error);
+  if (error != nullptr) {
+    return nullptr;
+  }
+  return std::make_shared<AstDeclarationStatement>(t, std::static_pointer_cast<AstIdentifier>(identifier));
 }
 
-pParserError IdentifierProc::verify(pToken t) {
+pAstNode IdentifierProc::parse(pToken t, pParserError& error) {
   if (!check(t)) {
-    return newPError("Identifier: expected identifier token, got " + t->typeToString());
+    error = newPError("Identifier: expected identifier token, got " + t->typeToString());
+    return nullptr;
   }
-  auto idToken = std::dynamic_pointer_cast<PreIdentifier>(t);
-
-  for (auto tt : idToken->tokens) {
-    if (tt->isTypeOf(TokenType::WORD)) {
-      continue;
-    }
+  auto idToken = std::static_pointer_cast<PreIdentifier>(t);
 
-    if (tt->isTypeOf(TokenType::PARAMETER)) {
-      continue;
+  for (auto& tt : idToken->tokens) {
+    if (!tt->isTypeOf({ TokenType::WORD, TokenType::PARAMETER })) {
+      error = newPError("Identifier: Illigal token type: " + tt->typeToString());
+      return nullptr;
     }
-
-    return newPError("Identifier: Illigal token type: " + tt->typeToString());
   }
 
-  return nullptr;
-}
-pAstNode IdentifierProc::create(pToken t) {
-  auto idToken = std::dynamic_pointer_cast<PreIdentifier>(t);
   return std::make_shared<AstIdentifier>(t, idToken);
 }
 
-pParserError ExpressionProc::verifyTokens(Tokens tokens) {
-  for (auto t : tokens) {
-    auto error = verify(t);
 
-    if (error != nullptr) {
-      return error;
-    }
+// Calls with the same words and parameter slots resolve to the same
+// identifier, so each distinct phrase is looked up through the scopes once
+// per parse and later calls from this scope reuse it.
+std::shared_ptr<PreIdentifier> CallProc::checkLine(TokenSpan tokens, TokenSpan::iterator it) {
+  if (it == tokens.end() || !(*it)->isTypeOf(TokenType::IDENTIFIER)) {
+    return nullptr;
   }
+  // safe since type is checked with type property
+  auto& called = static_cast<const PreToken&>(**it);
+  auto& resolved = (*calls)[phrase::shape(called)];
 
-  return nullptr;
-}
-
-std::shared_ptr<PreIdentifier> CallProc::checkLine(Tokens tokens, Tokens::iterator it) {
-  return checkIdentifiersForLinePerScope(tokens, it, scope);
-}
-
-std::shared_ptr<PreIdentifier> CallProc::checkIdentifiersForLinePerScope(Tokens tokens, Tokens::iterator it, pPreScope s) {
-  for (auto id : s->identifiers) {
-    auto found = checkIdentifier(tokens, it, id);
-    if (found) {
-      return found;
+  for (auto& id : resolved) {
+    if (phrase::matches(*id, called)) {
+      return id;
     }
   }
 
-  if (s->broader != nullptr) {
-    return checkIdentifiersForLinePerScope(tokens, it, s->broader);
+  auto found = checkIdentifiersForLinePerScope(tokens, it, scope.get());
+  if (found) {
+    resolved.push_back(found);
   }
-
-  return nullptr;
+  return found;
 }
 
-std::shared_ptr<PreIdentifier> CallProc::checkIdentifier(Tokens tokens, Tokens::iterator it, pPreIdentifier id) {
-  auto identifier = std::dynamic_pointer_cast<PreIdentifier>(*it);
-
-  if (id->tokens.size() != identifier->tokens.size()) {
+// Each scope indexes its identifiers by phrase shape, so a call costs the
+// length of its phrase per scope and broader scopes are only asked on a miss.
+std::shared_ptr<PreIdentifier> CallProc::checkIdentifiersForLinePerScope(TokenSpan tokens, TokenSpan::iterator it, PreScope* s) {
+  if (it == tokens.end() || !(*it)->isTypeOf(TokenType::IDENTIFIER)) {
     return nullptr;
   }
-  for (u_int i = 0; i < identifier->tokens.size(); ++i) {
-    auto idToken = id->tokens[i];
-    auto lineToken = identifier->tokens[i];
-
-    if (idToken->isTypeOf(TokenType::PARAMETER) && lineToken->isTypeOf(TokenType::PARAMETER)) {
-      continue;
-    }
+  // safe since type is checked with type property
+  auto& called = static_cast<const PreToken&>(**it);
+  auto shape = phrase::shape(called);
 
-    if (idToken != lineToken) {
-      return nullptr;
+  for (; s != nullptr; s = s->broaderScope()) {
+    if (auto found = s->findPhrase(called, shape)) {
+      return *found;
     }
   }
 
-  return id;
+  return nullptr;
 }
 
-pAstCall CallProc::create(Tokens tokens, Tokens::iterator& it) {
-  auto identifier = std::dynamic_pointer_cast<PreIdentifier>(*it);
-  auto call = std::make_shared<AstCall>((*it), identifier);
-  it = std::next(it);
-  return call;
-}
\ No newline at end of file
+std::shared_ptr<PreIdentifier> CallProc::checkIdentifier(TokenSpan tokens, TokenSpan::iterator it, const pPreIdentifier& id) {
+  if (it == tokens.end() || !(*it)->isTypeOf(TokenType::IDENTIFIER)) {
+    return nullptr;
+  }
+  // safe since type is checked with type property
+  return phrase::matches(*id, static_cast<const PreToken&>(**it)) ? id : nullptr;
+}
@@ -0,0 +1,198 @@
+#include "scan.h"
+
+#if defined(__x86_64__)
+#define ABLE_X86 1
+#include <immintrin.h>
+#endif
+
+using scan::isNumberByte;
+using scan::isWordByte;
+
+namespace {
+
+  template <typename Pred>
+  inline size_t scalarRun(const char* p, size_t n, size_t i, Pred pred) {
+    while (i < n && pred(static_cast<unsigned char>(p[i]))) {
+      ++i;
+    }
+    return i;
+  }
+
+  size_t scalarWordRun(const char* p, size_t n) {
+    return scalarRun(p, n, 0, isWordByte);
+  }
+
+  size_t scalarNumberRun(const char* p, size_t n) {
+    return scalarRun(p, n, 0, isNumberByte);
+  }
+
+  size_t scalarSpaceRun(const char* p, size_t n) {
+    return scalarRun(p, n, 0, [](unsigned char c) { return c == ' '; });
+  }
+
+  size_t scalarUntilNewline(const char* p, size_t n) {
+    return scalarRun(p, n, 0, [](unsigned char c) { return c != '\n'; });
+  }
+
+#ifdef ABLE_X86
+
+  // Unsigned range check lo <= c <= hi with signed byte compares: shift the
+  // range so that lo maps to -128 and compare against the shifted upper bound.
+  inline __m128i inRange16(__m128i v, char lo, char hi) {
+    auto shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(-128 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + (hi - lo + 1))));
+  }
+
+  inline __m128i wordMask16(__m128i v) {
+    auto letter = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    auto digit = inRange16(v, '0', '9');
+    auto dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+    auto dash = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+    return _mm_or_si128(_mm_or_si128(letter, digit), _mm_or_si128(dot, dash));
+  }
+
+  inline __m128i numberMask16(__m128i v) {
+    return _mm_or_si128(inRange16(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+  }
+
+  inline __m128i spaceMask16(__m128i v) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+  }
+
+  inline __m128i notNewlineMask16(__m128i v) {
+    return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_set1_epi8(-1));
+  }
+
+  // Advances while every byte of the block matches the class, then finishes
+  // the partial block and the tail with the scalar predicate.
+  template <typename Mask, typename Pred>
+  inline size_t sse2Run(const char* p, size_t n, Mask mask, Pred pred) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      unsigned bits = ~static_cast<unsigned>(_mm_movemask_epi8(mask(v))) & 0xFFFF;
+      if (bits != 0) {
+        return i + __builtin_ctz(bits);
+      }
+    }
+    return scalarRun(p, n, i, pred);
+  }
+
+  size_t sse2WordRun(const char* p, size_t n) {
+    return sse2Run(p, n, wordMask16, isWordByte);
+  }
+
+  size_t sse2NumberRun(const char* p, size_t n) {
+    return sse2Run(p, n, numberMask16, isNumberByte);
+  }
+
+  size_t sse2SpaceRun(const char* p, size_t n) {
+    return sse2Run(p, n, spaceMask16, [](unsigned char c) { return c == ' '; });
+  }
+
+  size_t sse2UntilNewline(const char* p, size_t n) {
+    return sse2Run(p, n, notNewlineMask16, [](unsigned char c) { return c != '\n'; });
+  }
+
+#define ABLE_AVX2 __attribute__((target("avx2")))
+
+  ABLE_AVX2 inline __m256i inRange32(__m256i v, char lo, char hi) {
+    auto shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(-128 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + (hi - lo + 1))), shifted);
+  }
+
+  ABLE_AVX2 inline __m256i wordMask32(__m256i v) {
+    auto letter = inRange32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    auto digit = inRange32(v, '0', '9');
+    auto dot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+    auto dash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'));
+    return _mm256_or_si256(_mm256_or_si256(letter, digit), _mm256_or_si256(dot, dash));
+  }
+
+  ABLE_AVX2 inline __m256i numberMask32(__m256i v) {
+    return _mm256_or_si256(inRange32(v, '0', '9'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+  }
+
+  ABLE_AVX2 inline __m256i spaceMask32(__m256i v) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+  }
+
+  ABLE_AVX2 inline __m256i notNewlineMask32(__m256i v) {
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_set1_epi8(-1));
+  }
+
+  template <typename Mask, typename Pred>
+  ABLE_AVX2 inline size_t avx2Run(const char* p, size_t n, Mask mask, Pred pred) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      unsigned bits = ~static_cast<unsigned>(_mm256_movemask_epi8(mask(v)));
+      if (bits != 0) {
+        return i + __builtin_ctz(bits);
+      }
+    }
+    return scalarRun(p, n, i, pred);
+  }
+
+  ABLE_AVX2 size_t avx2WordRun(const char* p, size_t n) {
+    return avx2Run(p, n, wordMask32, isWordByte);
+  }
+
+  ABLE_AVX2 size_t avx2NumberRun(const char* p, size_t n) {
+    return avx2Run(p, n, numberMask32, isNumberByte);
+  }
+
+  ABLE_AVX2 size_t avx2SpaceRun(const char* p, size_t n) {
+    return avx2Run(p, n, spaceMask32, [](unsigned char c) { return c == ' '; });
+  }
+
+  ABLE_AVX2 size_t avx2UntilNewline(const char* p, size_t n) {
+    return avx2Run(p, n, notNewlineMask32, [](unsigned char c) { return c != '\n'; });
+  }
+
+#endif
+};
+
+const scan::Kernels& scan::scalar() {
+  static const Kernels kernels = { "scalar", scalarWordRun, scalarNumberRun, scalarSpaceRun, scalarUntilNewline };
+  return kernels;
+}
+
+const scan::Kernels& scan::sse2() {
+#ifdef ABLE_X86
+  static const Kernels kernels = { "sse2", sse2WordRun, sse2NumberRun, sse2SpaceRun, sse2UntilNewline };
+  return kernels;
+#else
+  return scalar();
+#endif
+}
+
+const scan::Kernels& scan::avx2() {
+#ifdef ABLE_X86
+  static const Kernels kernels = { "avx2", avx2WordRun, avx2NumberRun, avx2SpaceRun, avx2UntilNewline };
+  return kernels;
+#else
+  return scalar();
+#endif
+}
+
+bool scan::hasSse2() {
+#ifdef ABLE_X86
+  return __builtin_cpu_supports("sse2");
+#else
+  return false;
+#endif
+}
+
+bool scan::hasAvx2() {
+#ifdef ABLE_X86
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+const scan::Kernels& scan::best() {
+  static const Kernels& kernels = hasAvx2() ? avx2() : hasSse2() ? sse2() : scalar();
+  return kernels;
+}
@@ -1,41 +1,74 @@
 #include "scopeBuilder.h"
 
-void ScopeBuilder::build(Tokens &_tokens)
+void ScopeBuilder::open(u_int depth)
 {
-  for (auto t : _tokens)
+  if (current == nullptr)
   {
-    if (t->isTypeOf(TokenType::BLOCK))
+    current = arena->make<PreScope>();
+    current->depth = depth;
+
+    if (root == nullptr)
     {
-      // safe since type is checked with type property
-      auto block = std::dynamic_pointer_cast<PreBlock>(t);
-
-      if (current == nullptr)
-      {
-        current = std::make_shared<PreScope>();
-        current->depth = block->depth;
-
-        if (root == nullptr)
-        {
-          root = current;
-        }
-      }
-      else
-      {
-        while (block->depth < current->depth)
-        {
-          current = current->broader;
-        }
-
-        auto scope = std::make_shared<PreScope>(current);
-        current->narrower.push_back(scope);
-        scope->depth = block->depth;
-        current->tokens.push_back(scope);
-        current = scope;
-      }
+      root = current;
     }
-    else
+    return;
+  }
+
+  closeDeeperThan(depth);
+
+  auto scope = arena->make<PreScope>();
+  scope->broader = current->index;
+  current->narrower.push_back(scope->index);
+  scope->depth = depth;
+  current->tokens.push_back(scope);
+  current = scope;
+}
+
+void ScopeBuilder::closeDeeperThan(u_int depth)
+{
+  while (depth < current->depth)
+  {
+    current = arena->at<PreScope>(current->broader);
+  }
+}
+
+bool ScopeBuilder::add(pToken t)
+{
+  // a declaration ends the deeper scopes before it is listed, so it is
+  // followed by the scope it opens
+  if (t->isTypeOf(TokenType::DECLARE))
+  {
+    closeDeeperThan(static_cast<PreDeclare*>(t.get())->depth);
+  }
+  current->tokens.push_back(t);
+  bool added = true;
+
+  switch (t->type)
+  {
+  case TokenType::DECLARE:
+  {
+    // safe since type is checked with type property
+    auto decl = static_cast<PreDeclare*>(t.get());
+
+    // the name belongs to the scope the declaration is nested in
+    auto scope = current.get();
+    while (decl->depth <= scope->depth)
     {
-      current->tokens.push_back(t);
+      scope = scope->broaderScope();
     }
+    added = !decl->tokens.empty() && scope->addIdentifier(decl->tokens[0]);
+
+    open(decl->depth);
+    break;
+  }
+  case TokenType::ASSIGNMENT:
+  {
+    auto& tokens = static_cast<PreAssignment*>(t.get())->tokens;
+    added = !tokens.empty() && current->addIdentifier(tokens[0]);
+    break;
+  }
+  default:
+    break;
   }
-}
\ No newline at end of file
+  return added;
+}
@@ -177,10 +177,10 @@ void SemanticAnalyzer::removeLastAnalyzedLine()
 
 void SemanticAnalyzer::createIdentifier(
     std::shared_ptr<Token> partOf,
-    std::vector<TokenType> end)
+    TokenTypes end)
 {
   auto identifierToken = std::make_shared<Identifier>();
-  identifierToken->partOf = partOf;
+  identifierToken->partOf = partOf.get();
   analyzedTokens.push_back(identifierToken);
 
   if ((*srcIt)->isTypeOf(end))
@@ -202,7 +202,7 @@ void SemanticAnalyzer::createIdentifier(
     }
 
     analyzedTokens.push_back(*srcIt);
-    analyzedTokens.back()->partOf = identifierToken;
+    analyzedTokens.back()->partOf = identifierToken.get();
     ++srcIt;
   }
 }
@@ -210,7 +210,7 @@ void SemanticAnalyzer::createIdentifier(
 void SemanticAnalyzer::createParameter(std::shared_ptr<Token> identifier)
 {
   auto parameterToken = std::make_shared<Parameter>();
-  parameterToken->partOf = identifier;
+  parameterToken->partOf = identifier.get();
   analyzedTokens.push_back(parameterToken);
   ++srcIt;
 
@@ -222,16 +222,16 @@ void SemanticAnalyzer::createParameter(std::shared_ptr<Token> identifier)
     }
 
     analyzedTokens.push_back(*srcIt);
-    analyzedTokens.back()->partOf = parameterToken;
+    analyzedTokens.back()->partOf = parameterToken.get();
     ++srcIt;
   }
   ++srcIt;
 }
 
-void SemanticAnalyzer::createExpression(std::shared_ptr<Token> partOf, std::vector<TokenType> end)
+void SemanticAnalyzer::createExpression(std::shared_ptr<Token> partOf, TokenTypes end)
 {
   auto expressionToken = std::make_shared<Expression>();
-  expressionToken->partOf = partOf;
+  expressionToken->partOf = partOf.get();
   analyzedTokens.push_back(expressionToken);
 
   if ((*srcIt)->isTypeOf(end))
@@ -242,7 +242,7 @@ void SemanticAnalyzer::createExpression(std::shared_ptr<Token> partOf, std::vect
   while (!(*++srcIt)->isTypeOf(end))
   {
     analyzedTokens.push_back(*srcIt);
-    analyzedTokens.back()->partOf = expressionToken;
+    analyzedTokens.back()->partOf = expressionToken.get();
   }
 }
 
@@ -255,7 +255,7 @@ void SemanticAnalyzer::searchIdentifier()
   {
     auto definition = definitions[i];
     auto reader = startingPoint;
-    std::shared_ptr<Token> endToken;
+    Token* endToken = nullptr;
 
     for (auto ident = definition->next; ident != NULL && ident->isPartOf({definition}); ident = ident->next)
     {
@@ -275,7 +275,7 @@ void SemanticAnalyzer::searchIdentifier()
         endToken = ident;
         ++reader;
 
-        while ((*reader)->literal != endToken->literal)
+        while (!(*reader)->sameLiteral(*endToken))
         {
           if ((*reader)->isTypeOf({TokenType::ENDL, TokenType::END_OF_FILE}))
           {
@@ -286,7 +286,7 @@ void SemanticAnalyzer::searchIdentifier()
         }
       }
 
-      if (ident->literal != (*reader)->literal)
+      if (!ident->sameLiteral(**reader))
       {
         possibleDefinitions.erase(possibleDefinitions.begin() + i);
         break;
@@ -300,7 +300,7 @@ void SemanticAnalyzer::searchIdentifier()
     auto callToken = std::make_shared<Call>();
     auto definition = possibleDefinitions[0];
 
-    callToken->relatedTo = definition;
+    callToken->relatedTo = definition.get();
     analyzedTokens.push_back(callToken);
 
     for (auto definitionToken = definition->next; !definitionToken->isTypeOf({TokenType::ENDL, TokenType::END_OF_FILE, TokenType::WITH});)
@@ -318,7 +318,7 @@ void SemanticAnalyzer::searchIdentifier()
         continue;
       }
       analyzedTokens.push_back(*srcIt);
-      analyzedTokens.back()->partOf = callToken;
+      analyzedTokens.back()->partOf = callToken.get();
       ++srcIt;
       definitionToken = definitionToken->next;
     }
@@ -370,7 +370,7 @@ std::string SemanticAnalyzer::searchKeyPhrase()
       //     matching token to end the parameter. If so, check next token.
       // 3) Otherwise it not a match.
 
-      if (curPToken->type == curSToken->type && curPToken->literal == curSToken->literal)
+      if (*curPToken == *curSToken)
       {
         curSToken = curSToken->next;
         curPToken = curPToken->next;
@@ -392,7 +392,7 @@ std::string SemanticAnalyzer::searchKeyPhrase()
         {
           auto paramEnd = curPToken;
 
-          while (curSToken->type != TokenType::ENDL && curSToken->type != TokenType::END_OF_FILE && curSToken->type == paramEnd->type && curSToken->literal == paramEnd->literal)
+          while (curSToken->type != TokenType::ENDL && curSToken->type != TokenType::END_OF_FILE && *curSToken == *paramEnd)
           {
             curSToken = curSToken->next;
           }
@@ -452,7 +452,7 @@ std::vector<Tokens> SemanticAnalyzer::gatherKeyPhraseArgs(std::string keyPhraseN
       }
       else
       {
-        while (sToken != nullptr && sToken->isTypeOf({endToken->type}) && sToken->literal != endToken->literal)
+        while (sToken != nullptr && sToken->isTypeOf({endToken->type}) && !sToken->sameLiteral(*endToken))
         {
           // at this point there should not need end of file or endl checks because
           // matching phrase is already found.
@@ -487,14 +487,14 @@ void SemanticAnalyzer::addKeyPhrase(std::string keyPhraseName, std::vector<Token
     if (cToken->isTypeOf({TokenType::ARGUMENT}))
     {
       auto argToken = std::make_shared<Argument>();
-      argToken->relatedTo = args[curArg][0]; // first token in the list is the parameter token of whom this argument is related to
+      argToken->relatedTo = args[curArg][0].get(); // first token in the list is the parameter token of whom this argument is related to
       auto exprToken = std::make_shared<Expression>(argToken);
       analyzedTokens.push_back(argToken);
       analyzedTokens.push_back(exprToken);
 
       for (auto it = args[curArg].begin() + 1; it != args[curArg].end(); ++it)
       {
-        (*it)->partOf = exprToken;
+        (*it)->partOf = exprToken.get();
         analyzedTokens.push_back(*it);
         ++callLength;
       }
@@ -518,14 +518,14 @@ void SemanticAnalyzer::addKeyPhrase(std::string keyPhraseName, std::vector<Token
 
 void SemanticAnalyzer::createArgument(
     std::shared_ptr<Token> callToken,
-    std::shared_ptr<Token> paramToken,
-    std::shared_ptr<Token> endToken)
+    Token* paramToken,
+    Token* endToken)
 {
   auto argToken = std::make_shared<Argument>();
-  argToken->partOf = callToken;
+  argToken->partOf = callToken.get();
   argToken->relatedTo = paramToken;
   analyzedTokens.push_back(argToken);
-  std::vector<TokenType> end = {endToken->type};
+  TokenTypes end = {endToken->type};
 
   if (endToken->type == TokenType::ENDL || endToken->type == TokenType::END_OF_FILE)
   {
@@ -540,12 +540,12 @@ void SemanticAnalyzer::createArgument(
   while (!(*srcIt)->isTypeOf(end))
   {
     analyzedTokens.push_back(*srcIt);
-    analyzedTokens.back()->partOf = argToken;
+    analyzedTokens.back()->partOf = argToken.get();
     ++srcIt;
   }
 }
 
-void SemanticAnalyzer::omitTokens(std::vector<TokenType> types)
+void SemanticAnalyzer::omitTokens(TokenTypes types)
 {
   while (*srcIt != nullptr && (*srcIt)->isTypeOf(types))
   {
@@ -553,7 +553,7 @@ void SemanticAnalyzer::omitTokens(std::vector<TokenType> types)
   }
 }
 
-void SemanticAnalyzer::rewindIterator(std::vector<TokenType> types)
+void SemanticAnalyzer::rewindIterator(TokenTypes types)
 {
   while (!(*srcIt)->isTypeOf(types))
   {
@@ -566,7 +566,7 @@ void SemanticAnalyzer::rewindIterator(std::vector<TokenType> types)
   ++srcIt;
 }
 
-int SemanticAnalyzer::findLastAnalyzedTokenIndex(std::vector<TokenType> types)
+int SemanticAnalyzer::findLastAnalyzedTokenIndex(TokenTypes types)
 {
   auto it = analyzedTokens.end() - 1;
   while (!(*it)->isTypeOf(types))
@@ -0,0 +1,113 @@
+#include "sourceManager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+SourceManager::~SourceManager() {
+  for (auto& file : files) {
+    if (file->mapped != nullptr) {
+      munmap(file->mapped, file->text.size());
+    }
+  }
+}
+
+FileId SourceManager::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    auto error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+
+  auto file = std::make_unique<File>();
+  file->name = path;
+  // an empty file cannot be mapped and there is nothing to map
+  if (info.st_size > 0) {
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      auto error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    // the lexer reads it once from start to end
+    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+    file->mapped = mapped;
+    file->text = std::string_view(static_cast<const char*>(mapped), info.st_size);
+  }
+  close(fd);
+  return addFile(std::move(file));
+}
+
+FileId SourceManager::add(std::string name, std::string text) {
+  auto file = std::make_unique<File>();
+  file->name = std::move(name);
+  file->owned = std::move(text);
+  file->text = file->owned;
+  return addFile(std::move(file));
+}
+
+// Every source takes one location more than its size, so the end of a source
+// has a location that is not the start of the next one.
+FileId SourceManager::addFile(std::unique_ptr<File> file) {
+  if (file->text.size() >= std::numeric_limits<SourceLocation>::max() - next) {
+    throw std::length_error("SourceManager: sources do not fit into 32 bit locations: " + file->name);
+  }
+  file->base = next;
+  next += file->text.size() + 1;
+  bases.push_back(file->base);
+  files.push_back(std::move(file));
+  return files.size() - 1;
+}
+
+FileId SourceManager::fileOf(SourceLocation location) const {
+  if (location == NO_LOCATION || location >= next) {
+    throw std::out_of_range("SourceManager: unknown location " + std::to_string(location));
+  }
+  return std::upper_bound(bases.begin(), bases.end(), location) - bases.begin() - 1;
+}
+
+SourcePosition SourceManager::position(SourceLocation location) const {
+  auto& file = *files[fileOf(location)];
+  u_int offset = location - file.base;
+  auto& starts = lineStarts(file);
+  u_int line = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+  return { file.name, line, offset - starts[line - 1] + 1 };
+}
+
+void SourceManager::resolve(Diagnostics& diagnostics) const {
+  for (auto& diagnostic : diagnostics) {
+    if (diagnostic.location != NO_LOCATION) {
+      auto at = position(diagnostic.location);
+      diagnostic.line = at.line;
+      diagnostic.column = at.column;
+    }
+  }
+}
+
+const std::vector<u_int>& SourceManager::lineStarts(const File& file) const {
+  std::call_once(file.indexed, [&file]() {
+    auto first = file.text.data();
+    auto end = first + file.text.size();
+    file.lineStarts.push_back(0);
+    for (auto at = first; at < end; ++at) {
+      at = static_cast<const char*>(std::memchr(at, '\n', end - at));
+      if (at == nullptr) {
+        break;
+      }
+      file.lineStarts.push_back(at + 1 - first);
+    }
+  });
+  return file.lineStarts;
+}
@@ -0,0 +1,112 @@
+#include "symbols.h"
+#include <atomic>
+#include <mutex>
+
+Symbol SymbolTable::intern(std::string_view text) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto found = ids.find(text);
+    if (found != ids.end()) {
+      return found->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  // another thread may have interned it while the lock was released
+  auto found = ids.find(text);
+  if (found != ids.end()) {
+    return found->second;
+  }
+
+  strings.emplace_back(text);
+  Symbol symbol = strings.size();
+  ids.emplace(strings.back(), symbol);
+  return symbol;
+}
+
+Symbol SymbolTable::find(std::string_view text) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  auto found = ids.find(text);
+  return found == ids.end() ? 0 : found->second;
+}
+
+std::string_view SymbolTable::view(Symbol symbol) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  if (symbol == 0 || symbol > strings.size()) {
+    return {};
+  }
+  return strings[symbol - 1];
+}
+
+size_t SymbolTable::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return strings.size();
+}
+
+namespace {
+  // words a thread caches before it starts over
+  constexpr size_t CACHE_LIMIT = 4096;
+
+  struct Current {
+    std::mutex mutex;
+    pSymbolTable table = std::make_shared<SymbolTable>(1);
+    std::atomic<uint32_t> generation = 1;
+  };
+
+  Current& state() {
+    static Current current;
+    return current;
+  }
+
+  // Holds the table it caches, so the views it keys by stay valid after a
+  // reset until the thread interns into a newer table.
+  struct Cache {
+    pSymbolTable table;
+    std::unordered_map<std::string_view, Symbol> symbols;
+  };
+
+  thread_local Cache cache;
+};
+
+pSymbolTable symbols::current() {
+  auto& current = state();
+  std::lock_guard<std::mutex> lock(current.mutex);
+  return current.table;
+}
+
+void symbols::reset() {
+  auto& current = state();
+  std::lock_guard<std::mutex> lock(current.mutex);
+  current.table = std::make_shared<SymbolTable>(current.table->generation + 1);
+  current.generation.store(current.table->generation, std::memory_order_release);
+}
+
+// Every thread caches its lookups with keys that view the interned strings
+// of the table it holds, and skips the table lock on a hit.
+Symbol symbols::intern(const pSymbolTable& table, std::string_view text) {
+  if (cache.table != table || cache.symbols.size() >= CACHE_LIMIT) {
+    cache.symbols.clear();
+    cache.table = table;
+  }
+
+  auto found = cache.symbols.find(text);
+  if (found != cache.symbols.end()) {
+    return found->second;
+  }
+
+  auto symbol = table->intern(text);
+  cache.symbols.emplace(table->view(symbol), symbol);
+  return symbol;
+}
+
+// The cached table is used as long as no reset happened, so the current one
+// is only locked once per generation and thread.
+Symbol symbols::intern(std::string_view text, uint32_t& generation) {
+  if (cache.table == nullptr || cache.table->generation != state().generation.load(std::memory_order_acquire)) {
+    auto table = current();
+    generation = table->generation;
+    return intern(table, text);
+  }
+  generation = cache.table->generation;
+  return intern(cache.table, text);
+}
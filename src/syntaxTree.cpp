@@ -0,0 +1,250 @@
+#include "syntaxTree.h"
+#include "tokenBuffer.h"
+#include <algorithm>
+
+using syntax::GreenNode;
+using syntax::GreenNodes;
+using syntax::GreenToken;
+using syntax::Kind;
+using syntax::pGreenNode;
+using syntax::MAX_CHILDREN;
+
+namespace {
+
+  pGreenNode makeLine(std::vector<GreenToken> tokens, Diagnostics problems) {
+    auto line = std::make_shared<GreenNode>();
+    line->kind = Kind::LINE;
+    line->lines = 1;
+    for (auto& token : tokens) {
+      line->width += token.text.length();
+    }
+    line->tokens = std::move(tokens);
+    line->problems = std::move(problems);
+    return line;
+  }
+
+  pGreenNode makeGroup(GreenNodes::const_iterator first, GreenNodes::const_iterator last) {
+    auto group = std::make_shared<GreenNode>();
+    group->kind = Kind::GROUP;
+    group->height = (*first)->height + 1;
+    for (auto it = first; it != last; ++it) {
+      group->width += (*it)->width;
+      group->lines += (*it)->lines;
+    }
+    group->children.assign(first, last);
+    return group;
+  }
+
+  // nodes of one height in as few groups as they fit in, of even size
+  GreenNodes group(const GreenNodes& nodes) {
+    GreenNodes groups;
+    size_t count = (nodes.size() + MAX_CHILDREN - 1) / MAX_CHILDREN;
+    for (size_t i = 0; i < count; ++i) {
+      groups.push_back(makeGroup(nodes.begin() + nodes.size() * i / count,
+        nodes.begin() + nodes.size() * (i + 1) / count));
+    }
+    return groups;
+  }
+
+  pGreenNode rootOf(GreenNodes nodes) {
+    while (nodes.size() > 1 || nodes.front()->kind == Kind::LINE) {
+      nodes = group(nodes);
+    }
+    auto root = nodes.front();
+    while (root->height > 1 && root->children.size() == 1) {
+      root = root->children.front();
+    }
+    return root;
+  }
+
+  // Lexes src into lines. Unless atEnd, src ends with a newline and its lines
+  // go on in the text after it, so there is no END_OF_FILE token.
+  GreenNodes lexLines(std::string_view src, bool atEnd) {
+    auto lexer = Lexer::borrow(src);
+    lexer.recover = true;
+    lexer.generateTokenBuffer();
+    auto& buffer = lexer.buffer;
+    auto problem = lexer.diagnostics.begin();
+
+    GreenNodes lines;
+    std::vector<GreenToken> tokens;
+    Diagnostics problems;
+    u_int lineStart = 0;
+    u_int end = 0;
+    for (u_int i = 0; i < buffer.size(); ++i) {
+      auto type = buffer.type(i);
+      if (type == TokenType::END_OF_FILE && !atEnd) {
+        break;
+      }
+      u_int start = buffer.offsets[i];
+      // trailing spaces of the source belong to END_OF_FILE
+      u_int tokenEnd = type == TokenType::END_OF_FILE ? src.length() : start + buffer.lengths[i];
+      tokens.push_back({ type, start - end, std::string(src.substr(end, tokenEnd - end)) });
+      end = tokenEnd;
+
+      // problems come in the order of their tokens
+      for (; problem != lexer.diagnostics.end() && problem->location - FIRST_LOCATION < end; ++problem) {
+        problems.push_back(*problem);
+        problems.back().location -= lineStart;
+      }
+      if (type == TokenType::ENDL || type == TokenType::END_OF_FILE) {
+        lines.push_back(makeLine(std::move(tokens), std::move(problems)));
+        tokens.clear();
+        problems.clear();
+        lineStart = end;
+      }
+    }
+    return lines;
+  }
+
+  // Replaces the lines [from, to) under node with lines. Gives the nodes of
+  // the height of node that take its place: none when nothing is left in it
+  // and more than one when it overflows. Children that are not touched are
+  // shared.
+  GreenNodes splice(const pGreenNode& node, u_int from, u_int to, const GreenNodes& lines) {
+    GreenNodes children;
+    if (node->height == 1) {
+      children.insert(children.end(), node->children.begin(), node->children.begin() + from);
+      children.insert(children.end(), lines.begin(), lines.end());
+      children.insert(children.end(), node->children.begin() + to, node->children.end());
+    } else {
+      bool inserted = false;
+      u_int start = 0;
+      for (size_t i = 0; i < node->children.size(); ++i) {
+        auto& child = node->children[i];
+        u_int end = start + child->lines;
+        // lines go into the child holding from, or the last one when appended
+        bool holdsFrom = !inserted && (from < end || i + 1 == node->children.size());
+        if (holdsFrom || (inserted && start < to)) {
+          auto replaced = holdsFrom
+            ? splice(child, from - start, std::min(to, end) - start, lines)
+            : splice(child, 0, std::min(to, end) - start, {});
+          children.insert(children.end(), replaced.begin(), replaced.end());
+          inserted = true;
+        } else {
+          children.push_back(child);
+        }
+        start = end;
+      }
+    }
+
+    if (children.empty()) {
+      return {};
+    }
+    return group(children);
+  }
+
+  template <typename F>
+  void forEachLine(const GreenNode& node, u_int& offset, F&& f) {
+    if (node.kind == Kind::LINE) {
+      f(node, offset);
+      offset += node.width;
+      return;
+    }
+    for (auto& child : node.children) {
+      forEachLine(*child, offset, f);
+    }
+  }
+
+  void appendText(const GreenNode& line, std::string& out) {
+    for (auto& token : line.tokens) {
+      out += token.text;
+    }
+  }
+};
+
+SyntaxTree SyntaxTree::parse(std::string_view src) {
+  SyntaxTree tree;
+  tree.root = rootOf(lexLines(src, true));
+  return tree;
+}
+
+// The edited text runs from the start of the line holding the edit to the
+// end of the line holding its end. When the edit leaves that text without
+// a newline at the end, the next line is joined to it.
+SyntaxTree SyntaxTree::edit(SourceEdit change) const {
+  auto first = lineAt(change.offset);
+  auto last = lineAt(change.offset + change.removed);
+
+  std::string text;
+  u_int end = last.index + 1;
+  for (u_int i = first.index; i < end; ++i) {
+    appendText(*line(i).green, text);
+  }
+  text.replace(change.offset - first.offset, change.removed, change.inserted);
+  if ((text.empty() || text.back() != '\n') && end < lineCount()) {
+    appendText(*line(end).green, text);
+    ++end;
+  }
+
+  SyntaxTree tree;
+  tree.root = rootOf(splice(root, first.index, end, lexLines(text, end == lineCount())));
+  return tree;
+}
+
+SyntaxLine SyntaxTree::line(u_int index) const {
+  const GreenNode* node = root.get();
+  u_int first = 0;
+  u_int offset = 0;
+  while (node->kind != Kind::LINE) {
+    for (auto& child : node->children) {
+      if (index < first + child->lines) {
+        node = child.get();
+        break;
+      }
+      first += child->lines;
+      offset += child->width;
+    }
+  }
+  return { node, first, offset };
+}
+
+SyntaxLine SyntaxTree::lineAt(u_int offset) const {
+  const GreenNode* node = root.get();
+  u_int index = 0;
+  u_int start = 0;
+  while (node->kind != Kind::LINE) {
+    for (size_t i = 0; i < node->children.size(); ++i) {
+      auto& child = node->children[i];
+      if (offset < start + child->width || i + 1 == node->children.size()) {
+        node = child.get();
+        break;
+      }
+      index += child->lines;
+      start += child->width;
+    }
+  }
+  return { node, index, start };
+}
+
+std::string SyntaxTree::text() const {
+  std::string out;
+  out.reserve(width());
+  u_int offset = 0;
+  forEachLine(*root, offset, [&](const GreenNode& line, u_int) { appendText(line, out); });
+  return out;
+}
+
+Tokens SyntaxTree::tokens(SourceLocation base) const {
+  Tokens out;
+  u_int offset = 0;
+  forEachLine(*root, offset, [&](const GreenNode& line, u_int at) {
+    for (auto& token : line.tokens) {
+      out.push_back(token::make(token.type, std::string_view(token.text).substr(token.trivia), base + at + token.trivia));
+      at += token.text.length();
+    }
+  });
+  return out;
+}
+
+Diagnostics SyntaxTree::diagnostics(SourceLocation base) const {
+  Diagnostics out;
+  u_int offset = 0;
+  forEachLine(*root, offset, [&](const GreenNode& line, u_int at) {
+    for (auto problem : line.problems) {
+      problem.location += base - FIRST_LOCATION + at;
+      out.push_back(problem);
+    }
+  });
+  return out;
+}
@@ -0,0 +1,133 @@
+#include "threadPool.h"
+#include <algorithm>
+
+namespace {
+  // the pool and queue of the worker running on this thread
+  thread_local const ThreadPool* currentPool = nullptr;
+  thread_local u_int currentQueue = 0;
+};
+
+ThreadPool::ThreadPool(u_int threads) {
+  threads = std::max(threads, 1u);
+  for (u_int i = 0; i <= threads; ++i) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (u_int i = 0; i < threads; ++i) {
+    workers.emplace_back([this, i]() { work(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+u_int ThreadPool::ownQueue() const {
+  return currentPool == this ? currentQueue : queues.size() - 1;
+}
+
+void ThreadPool::run(Group& group, std::function<void()> task) {
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+  auto& queue = *queues[ownQueue()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back([&group, task = std::move(task)]() {
+      std::exception_ptr error;
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      finish(group, error);
+    });
+  }
+  queued.fetch_add(1, std::memory_order_release);
+  // a worker that has just found nothing to do is either waiting already or
+  // sees the new count once it holds the lock, the same for the waiter of
+  // the group when every worker is busy
+  { std::lock_guard<std::mutex> lock(sleep); }
+  wake.notify_one();
+  { std::lock_guard<std::mutex> lock(group.mutex); }
+  group.changed.notify_all();
+}
+
+// The count drops under the lock and the waiter looks at it under the lock
+// last, so the group is not touched after wait has returned.
+void ThreadPool::finish(Group& group, std::exception_ptr error) {
+  std::lock_guard<std::mutex> lock(group.mutex);
+  if (error != nullptr && group.error == nullptr) {
+    group.error = error;
+  }
+  if (group.pending.fetch_sub(1, std::memory_order_release) == 1) {
+    group.changed.notify_all();
+  }
+}
+
+void ThreadPool::wait(Group& group) {
+  auto index = ownQueue();
+  std::exception_ptr error;
+  while (true) {
+    if (group.pending.load(std::memory_order_acquire) > 0 && runOne(index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(group.mutex);
+    if (group.pending.load(std::memory_order_acquire) == 0) {
+      std::swap(error, group.error);
+      break;
+    }
+    // the rest of the group runs on other threads, or was queued since
+    if (queued.load(std::memory_order_acquire) == 0) {
+      group.changed.wait(lock);
+    }
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool ThreadPool::runOne(u_int index) {
+  std::function<void()> task;
+  {
+    auto& own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+    }
+  }
+  for (u_int i = 1; task == nullptr && i < queues.size(); ++i) {
+    auto& other = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+    }
+  }
+  if (task == nullptr) {
+    return false;
+  }
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  task();
+  return true;
+}
+
+void ThreadPool::work(u_int index) {
+  currentPool = this;
+  currentQueue = index;
+  while (true) {
+    if (runOne(index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep);
+    wake.wait(lock, [this]() { return stop || queued.load(std::memory_order_acquire) > 0; });
+    if (stop) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,46 @@
+#include "tokenBuffer.h"
+#include <charconv>
+
+void TokenBuffer::push(TokenType type, uint32_t offset, uint32_t length) {
+  double value = 0;
+  Symbol symbol = 0;
+  if (type == TokenType::NUMBER) {
+    auto first = source.data() + offset;
+    std::from_chars(first, first + length, value);
+  } else if (type == TokenType::WORD) {
+    symbol = symbols::intern(table, source.substr(offset, length));
+  }
+
+  types.push_back(static_cast<uint8_t>(type));
+  offsets.push_back(offset);
+  lengths.push_back(length);
+  numbers.push_back(value);
+  symbols.push_back(symbol);
+}
+
+void TokenBuffer::clear() {
+  types.clear();
+  offsets.clear();
+  lengths.clear();
+  numbers.clear();
+  symbols.clear();
+}
+
+pToken TokenBuffer::toToken(u_int i) const {
+  return token::make(type(i), literal(i), location(i));
+}
+
+Tokens TokenBuffer::toTokens() const {
+  Tokens tokens;
+  tokens.reserve(size());
+  for (u_int i = 0; i < size(); ++i) {
+    tokens.push_back(toToken(i));
+  }
+  return tokens;
+}
+
+pToken token::make(TokenType type, std::string_view literal, SourceLocation location) {
+  auto token = std::make_shared<Token>(std::string(literal), type);
+  token->location = location;
+  return token;
+}
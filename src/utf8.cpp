@@ -0,0 +1,133 @@
+#include "utf8.h"
+#include "scan.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+  struct Range {
+    char32_t first;
+    char32_t last;
+  };
+
+  bool operator<(const Range& range, char32_t codePoint) {
+    return range.last < codePoint;
+  }
+
+  // sorted and non-overlapping
+  constexpr Range letters[] = {
+    { 0x00AA, 0x00AA }, { 0x00B5, 0x00B5 }, { 0x00BA, 0x00BA },
+    { 0x00C0, 0x00D6 }, { 0x00D8, 0x00F6 }, { 0x00F8, 0x02C1 },
+    { 0x02C6, 0x02D1 }, { 0x02E0, 0x02E4 },
+    { 0x0370, 0x0374 }, { 0x0376, 0x0377 }, { 0x037B, 0x037D }, { 0x037F, 0x037F },
+    { 0x0386, 0x0386 }, { 0x0388, 0x038A }, { 0x038C, 0x038C }, { 0x038E, 0x03A1 },
+    { 0x03A3, 0x03F5 }, { 0x03F7, 0x0481 }, { 0x048A, 0x052F },
+    { 0x0531, 0x0556 }, { 0x0561, 0x0587 },
+    { 0x05D0, 0x05EA },
+    { 0x0620, 0x064A }, { 0x0671, 0x06D3 },
+    { 0x0904, 0x0939 }, { 0x0958, 0x0961 },
+    { 0x0E01, 0x0E30 },
+    { 0x10A0, 0x10FF },
+    { 0x1E00, 0x1FBC },
+    { 0x3041, 0x3096 }, { 0x30A1, 0x30FA },
+    { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF },
+    { 0xAC00, 0xD7A3 },
+    { 0xF900, 0xFAFF },
+    { 0xFF21, 0xFF3A }, { 0xFF41, 0xFF5A },
+  };
+
+  constexpr Range marks[] = {
+    { 0x0300, 0x036F },
+    { 0x0483, 0x0489 },
+    { 0x0591, 0x05BD },
+    { 0x064B, 0x065F },
+    { 0x093A, 0x094F },
+    { 0x0E31, 0x0E3A }, { 0x0E47, 0x0E4E },
+    { 0x3099, 0x309A },
+  };
+
+  template <size_t N>
+  bool contains(const Range (&ranges)[N], char32_t codePoint) {
+    auto found = std::lower_bound(std::begin(ranges), std::end(ranges), codePoint);
+    return found != std::end(ranges) && found->first <= codePoint;
+  }
+};
+
+size_t utf8::decode(const char* p, size_t n, char32_t& codePoint) {
+  auto bytes = reinterpret_cast<const unsigned char*>(p);
+  if (n == 0) {
+    return 0;
+  }
+
+  auto lead = bytes[0];
+  size_t length;
+  char32_t min;
+  if (lead < 0x80) {
+    codePoint = lead;
+    return 1;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+    min = 0x80;
+    codePoint = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    min = 0x800;
+    codePoint = lead & 0x0F;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    min = 0x10000;
+    codePoint = lead & 0x07;
+  } else {
+    return 0;
+  }
+
+  if (n < length) {
+    return 0;
+  }
+
+  for (size_t i = 1; i < length; ++i) {
+    if ((bytes[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    codePoint = (codePoint << 6) | (bytes[i] & 0x3F);
+  }
+
+  if (codePoint < min || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+    return 0;
+  }
+
+  return length;
+}
+
+bool utf8::isLetter(char32_t codePoint) {
+  if (codePoint < 0x80) {
+    return scan::isLetterByte(codePoint);
+  }
+  return contains(letters, codePoint);
+}
+
+bool utf8::isWordLetter(char32_t codePoint) {
+  if (codePoint < 0x80) {
+    return scan::isWordByte(codePoint);
+  }
+  return contains(letters, codePoint) || contains(marks, codePoint);
+}
+
+size_t utf8::wordRun(const char* p, size_t n, size_t (*asciiRun)(const char*, size_t)) {
+  size_t i = 0;
+  while (i < n) {
+    i += asciiRun(p + i, n - i);
+
+    // pure ASCII words end here
+    if (i >= n || static_cast<unsigned char>(p[i]) < 0x80) {
+      return i;
+    }
+
+    char32_t codePoint;
+    auto length = decode(p + i, n - i, codePoint);
+    if (length == 0 || !isWordLetter(codePoint)) {
+      return i;
+    }
+    i += length;
+  }
+  return i;
+}
@@ -0,0 +1,108 @@
+#include <gmock/gmock.h>
+#include "astArena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "preparser.h"
+
+using namespace ::testing;
+
+class AstArenaTest: public Test {
+public:
+  AstArenaTest() {}
+
+  // the arena copy of the parsed program prints the same as the original
+  void testSameAsParser(std::string src) {
+    l = Lexer(src);
+    l.generateTokens();
+    pp = PreParser(l.tokens);
+    pp.prepareFromStart();
+    p = Parser(pp.scoped);
+    p.parseScope();
+
+    auto root = arena.add(p.scope);
+    EXPECT_EQ(arena.kind(root), ast::Kind::PROGRAM);
+    EXPECT_EQ(arena.toString(root), p.scope->toString());
+    EXPECT_EQ(arena.typeToString(root), p.scope->typeToString(0));
+  }
+
+  Lexer l;
+  PreParser pp;
+  Parser p;
+  AstArena arena;
+};
+
+TEST_F(AstArenaTest, ExpressionStatement) {
+  testSameAsParser("!-1 + 3 == 4 * 3");
+}
+
+TEST_F(AstArenaTest, Call) {
+  testSameAsParser("test\n"
+    "# test");
+}
+
+TEST_F(AstArenaTest, CallWithArgument) {
+  testSameAsParser("test _1_\n"
+    "# test _foo_");
+}
+
+TEST_F(AstArenaTest, BuildDirectly) {
+  auto two = arena.addNumber(token::make(TokenType::NUMBER, "2"), 2);
+  auto three = arena.addNumber(token::make(TokenType::NUMBER, "3.5"), 3.5);
+  auto sum = arena.add(ast::Kind::INFIX, token::make(TokenType::PLUS, "+"), two, three);
+  auto statement = arena.add(ast::Kind::EXPRESSION_STATEMENT, nullptr, sum);
+  auto program = arena.add(ast::Kind::PROGRAM, nullptr, arena.addList({ statement, statement }));
+
+  EXPECT_EQ(arena.size(), 5);
+  EXPECT_EQ(arena.list(arena.node(program).a).size(), 2);
+  EXPECT_DOUBLE_EQ(arena.number(three), 3.5);
+  EXPECT_EQ(arena.toString(program), "(2 + 3.5)\n(2 + 3.5)\n");
+  EXPECT_EQ(arena.typeToString(program, 1), "  PROGRAM\n"
+    "    EXPRESSION_STATEMENT->NUMBER + NUMBER\n"
+    "    EXPRESSION_STATEMENT->NUMBER + NUMBER\n");
+  EXPECT_EQ(sizeof(ast::Node), 16);
+
+  arena.clear();
+  EXPECT_EQ(arena.size(), 0);
+}
+
+// missing children, like the scope of a declaration nothing follows
+TEST_F(AstArenaTest, MissingChildren) {
+  auto name = arena.add(ast::Kind::PARAMETER);
+  auto declaration = arena.add(ast::Kind::DECLARATION, token::make(TokenType::DECLARE, "#"), name);
+  auto empty = arena.add(ast::Kind::EXPRESSION_STATEMENT);
+  auto program = arena.add(ast::Kind::PROGRAM, nullptr, arena.addList({ declaration, empty }));
+
+  EXPECT_EQ(arena.toString(program), "# \n");
+  EXPECT_EQ(arena.typeToString(program), "PROGRAM\n"
+    "  DECLARATION PARAM\n"
+    "  EXPRESSION_STATEMENT->\n");
+}
+
+// visitors get the arena and the index of the node
+struct CountNumbers {
+  int program(const AstArena& arena, ast::NodeIndex i) {
+    int count = 0;
+    for (auto statement : arena.list(arena.node(i).a)) {
+      count += arena.visit(statement, *this);
+    }
+    return count;
+  }
+  int expressionStatement(const AstArena& arena, ast::NodeIndex i) { return arena.visit(arena.node(i).a, *this); }
+  int declaration(const AstArena& arena, ast::NodeIndex i) { return arena.visit(arena.node(i).b, *this); }
+  int assignment(const AstArena& arena, ast::NodeIndex i) { return arena.visit(arena.node(i).b, *this); }
+  int number(const AstArena& arena, ast::NodeIndex i) { return 1; }
+  int prefix(const AstArena& arena, ast::NodeIndex i) { return arena.visit(arena.node(i).a, *this); }
+  int infix(const AstArena& arena, ast::NodeIndex i) { return arena.visit(arena.node(i).a, *this) + arena.visit(arena.node(i).b, *this); }
+  int call(const AstArena& arena, ast::NodeIndex i) { return 0; }
+  int identifier(const AstArena& arena, ast::NodeIndex i) { return 0; }
+  int parameter(const AstArena& arena, ast::NodeIndex i) { return 0; }
+};
+
+TEST_F(AstArenaTest, Visitor) {
+  testSameAsParser("1 + 2 * 3\n"
+    "-4 == 5");
+
+  CountNumbers counter;
+  EXPECT_EQ(arena.visit(0, counter), 1);
+  EXPECT_EQ(arena.visit(arena.size() - 1, counter), 5);
+}
@@ -0,0 +1,88 @@
+#include <gmock/gmock.h>
+#include "blocks.h"
+
+using namespace ::testing;
+using blocks::LineKind;
+
+class BlocksTest: public Test {
+public:
+  BlocksTest() {}
+
+  void testKinds(std::string src, std::vector<LineKind> expected) {
+    auto map = blocks::classify(src);
+    EXPECT_EQ(map.kinds, expected);
+    EXPECT_EQ(map.end, src.size());
+
+    // every kernel gives the same map
+    for (auto kernels : { &scan::scalar(), &scan::sse2(), &scan::avx2() }) {
+      if (kernels == &scan::avx2() && !scan::hasAvx2()) {
+        continue;
+      }
+      EXPECT_EQ(blocks::classify(src, *kernels).starts, map.starts) << kernels->name;
+    }
+  }
+};
+
+TEST_F(BlocksTest, Empty) {
+  testKinds("", {});
+}
+
+TEST_F(BlocksTest, Document) {
+  std::string src = "# Main program\n"
+    "\n"
+    "result = 2 + 3\n"
+    "```js\n"
+    "let x = 1;\n"
+    "\n"
+    "```\n"
+    "  \t \n"
+    "- 1234 carrots";
+
+  testKinds(src, {
+    LineKind::HEADING, LineKind::BLANK, LineKind::PARAGRAPH,
+    LineKind::FENCE, LineKind::FENCED, LineKind::FENCED, LineKind::FENCE,
+    LineKind::BLANK, LineKind::PARAGRAPH,
+  });
+
+  auto map = blocks::classify(src);
+  EXPECT_EQ(map.starts[2], 16);
+  EXPECT_EQ(map.line(20), 2);
+  EXPECT_EQ(map.lineAfter(20), 3);
+}
+
+TEST_F(BlocksTest, Headings) {
+  testKinds("#\n###### six\n####### seven\n#5\n   # indented\n    # code\n## \r", {
+    LineKind::HEADING, LineKind::HEADING, LineKind::PARAGRAPH, LineKind::PARAGRAPH,
+    LineKind::HEADING, LineKind::PARAGRAPH, LineKind::HEADING,
+  });
+}
+
+TEST_F(BlocksTest, Fences) {
+  // closing fence has the opening marker at least as many times
+  testKinds("~~~~\n~~~\n```\n~~~~~ \nx", {
+    LineKind::FENCE, LineKind::FENCED, LineKind::FENCED, LineKind::FENCE, LineKind::PARAGRAPH,
+  });
+  // backtick info strings cannot hold backticks
+  testKinds("``` a`b\n``\n    ```\nx", {
+    LineKind::PARAGRAPH, LineKind::PARAGRAPH, LineKind::PARAGRAPH, LineKind::PARAGRAPH,
+  });
+  // closing fence cannot have an info string
+  testKinds("```\n``` x\n```", {
+    LineKind::FENCE, LineKind::FENCED, LineKind::FENCE,
+  });
+}
+
+TEST_F(BlocksTest, UnclosedFenceRunsToTheEnd) {
+  testKinds("x\n```\n# not a heading\ny", {
+    LineKind::PARAGRAPH, LineKind::FENCE, LineKind::FENCED, LineKind::FENCED,
+  });
+}
+
+TEST_F(BlocksTest, NextCode) {
+  std::string src = "a\n\n```\nb\n```\nc\n\n";
+  auto map = blocks::classify(src);
+  EXPECT_EQ(map.nextCode(0), 0);
+  EXPECT_EQ(map.nextCode(2), 13);
+  EXPECT_EQ(map.nextCode(13), 13);
+  EXPECT_EQ(map.nextCode(15), src.size());
+}
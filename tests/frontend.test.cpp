@@ -0,0 +1,99 @@
+#include <gmock/gmock.h>
+#include <thread>
+#include "frontend.h"
+
+using namespace ::testing;
+
+class FrontendTest: public Test {
+public:
+  std::vector<std::string> messages(const Compilation& compilation) {
+    std::vector<std::string> result;
+    for (auto& diagnostic : compilation.diagnostics) {
+      result.push_back(std::to_string(diagnostic.line) + ": " + diagnostic.msg);
+    }
+    return result;
+  }
+};
+
+TEST_F(FrontendTest, CompileWithoutProblems) {
+  auto compilation = frontend::compile("1 + 2\n"
+    "# test\n"
+    "test");
+  EXPECT_TRUE(compilation.ok());
+  EXPECT_EQ(compilation.program->toString(), "(1 + 2)\n# test\ntest\n");
+}
+
+TEST_F(FrontendTest, ReportEveryProblem) {
+  auto compilation = frontend::compile("1 + 2\n"
+    "1 +\n"
+    "foo __ bar\n"
+    "unknown\n"
+    "bar = \n"
+    "# name\n"
+    "3 * name\n"
+    "1.2.3 + 1");
+
+  EXPECT_FALSE(compilation.ok());
+  EXPECT_THAT(messages(compilation), ElementsAre(
+    "2: Parser: Expression Processor: expression ends unexpectedly",
+    "3: Double underscore is not supported",
+    "4: Parser: Expression Processor: unknown identifier: unknown",
+    "5: Preprocessor error: Assignment: Cannot assign empty",
+    "8: Number has more than one dot"));
+  // the statements without problems are kept
+  EXPECT_EQ(compilation.program->toString(), "(1 + 2)\n# name\n(3 * name)\n");
+}
+
+TEST_F(FrontendTest, ProblemInDeclarationScope) {
+  auto compilation = frontend::compile("# outer\n"
+    "## inner\n"
+    "missing + 1\n"
+    "inner\n"
+    "# other");
+
+  EXPECT_THAT(messages(compilation), ElementsAre(
+    "3: Parser: Expression Processor: unknown identifier: missing"));
+  EXPECT_EQ(compilation.program->toString(), "# outer\n# inner\ninner\n# other\n");
+}
+
+TEST_F(FrontendTest, CompileRepeatedly) {
+  for (int i = 0; i < 3; ++i) {
+    auto compilation = frontend::compile("1 +\n2");
+    EXPECT_EQ(compilation.diagnostics.size(), 1);
+    EXPECT_EQ(compilation.program->toString(), "2\n");
+  }
+}
+
+TEST_F(FrontendTest, CompileConcurrently) {
+  std::vector<std::string> sources;
+  for (int i = 0; i < 8; ++i) {
+    std::string name(i + 1, 'a' + i);
+    sources.push_back("# " + name + " _x_\n"
+      "## inner\n"
+      + name + " _1_ * inner - " + std::to_string(i) + "\n"
+      "inner + unknown\n"
+      "foo __ bar\n");
+  }
+  std::vector<Compilation> serial;
+  for (auto& source : sources) {
+    serial.push_back(frontend::compile(source));
+  }
+
+  std::vector<Compilation> concurrent(sources.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      for (int run = 0; run < 20; ++run) {
+        concurrent[i] = frontend::compile(sources[i]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < sources.size(); ++i) {
+    EXPECT_EQ(concurrent[i].program->toString(), serial[i].program->toString());
+    EXPECT_EQ(messages(concurrent[i]), messages(serial[i]));
+  }
+}
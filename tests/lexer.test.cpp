@@ -241,4 +241,482 @@ TEST_F(LexerTest, TooManyDots) {
     generateTokensFromSource(source);
     },
     SYNTAX_ERROR);
-}
\ No newline at end of file
+}
+
+TEST_F(LexerTest, TokenBufferMatchesTokens) {
+  std::string source = "# foo _bar_\n"
+    "baz = [2 times 5](times.md#x) >= 1.5 != !x\n";
+  generateTokensFromSource(source);
+  l.generateTokenBuffer();
+
+  ASSERT_EQ(l.buffer.size(), l.tokens.size());
+  for (u_int i = 0; i < l.tokens.size(); ++i) {
+    EXPECT_EQ(l.buffer.type(i), l.tokens[i]->type);
+    EXPECT_EQ(std::string(l.buffer.literal(i)), l.tokens[i]->literal);
+  }
+}
+
+TEST_F(LexerTest, TokenBufferBorrowsSource) {
+  std::string source = "foo 1.5";
+  auto lexer = Lexer::borrow(source);
+  lexer.generateTokenBuffer();
+
+  ASSERT_EQ(lexer.buffer.size(), 3);
+  EXPECT_EQ(lexer.buffer.literal(0).data(), source.data());
+  EXPECT_EQ(lexer.buffer.type(1), TokenType::NUMBER);
+  EXPECT_DOUBLE_EQ(lexer.buffer.number(1), 1.5);
+  EXPECT_EQ(lexer.buffer.type(2), TokenType::END_OF_FILE);
+}
+
+TEST_F(LexerTest, ParallelMatchesSerial) {
+  std::string source;
+  for (u_int i = 0; i < 200; ++i) {
+    source += "# Add _x_ times _y_ to _z_\n"
+      "result = 1.5 + " + std::to_string(i) + " * add 3 times 5 to 2\n\n";
+  }
+
+  Lexer serial(source);
+  serial.threads = 1;
+  serial.generateTokens();
+  serial.generateTokenBuffer();
+
+  Lexer parallel(source);
+  parallel.threads = 7;
+  parallel.parallelThreshold = 0;
+  parallel.generateTokens();
+  parallel.generateTokenBuffer();
+
+  ASSERT_EQ(parallel.tokens.size(), serial.tokens.size());
+  for (u_int i = 0; i < serial.tokens.size(); ++i) {
+    EXPECT_EQ(parallel.tokens[i]->type, serial.tokens[i]->type);
+    EXPECT_EQ(parallel.tokens[i]->literal, serial.tokens[i]->literal);
+  }
+
+  ASSERT_EQ(parallel.buffer.size(), serial.buffer.size());
+  EXPECT_EQ(parallel.buffer.types, serial.buffer.types);
+  EXPECT_EQ(parallel.buffer.offsets, serial.buffer.offsets);
+  EXPECT_EQ(parallel.buffer.numbers, serial.buffer.numbers);
+  EXPECT_EQ(parallel.buffer.type(parallel.buffer.size() - 1), TokenType::END_OF_FILE);
+}
+
+TEST_F(LexerTest, ParallelErrorPosition) {
+  std::string line = "foo bar baz\n";
+  std::string source;
+  for (u_int i = 0; i < 100; ++i) {
+    source += line;
+  }
+  source += "foo 1.0.0\n";
+  source += "bar __\n";
+
+  l = Lexer(source);
+  l.threads = 4;
+  l.parallelThreshold = 0;
+
+  try {
+    l.generateTokens();
+    FAIL() << "expected a syntax error";
+  } catch (SYNTAX_ERROR& e) {
+    EXPECT_EQ(e.pos, line.size() * 100 + 7);
+  }
+}
+
+class IncrementalLexerTest: public Test {
+public:
+  // apply edit incrementally and compare the result against lexing the edited source from scratch
+  void testEdit(std::string src, SourceEdit change, TokenEdit expected) {
+    Lexer incremental(src);
+    incremental.generateTokens();
+    incremental.generateTokenBuffer();
+    auto result = incremental.edit(change);
+
+    src.replace(change.offset, change.removed, change.inserted);
+    Lexer full(src);
+    full.generateTokenBuffer();
+
+    EXPECT_EQ(incremental.buffer.types, full.buffer.types);
+    EXPECT_EQ(incremental.buffer.offsets, full.buffer.offsets);
+    EXPECT_EQ(incremental.buffer.lengths, full.buffer.lengths);
+    EXPECT_EQ(incremental.buffer.numbers, full.buffer.numbers);
+    ASSERT_EQ(incremental.tokens.size(), full.buffer.size());
+    for (u_int i = 0; i < incremental.tokens.size(); ++i) {
+      EXPECT_EQ(incremental.tokens[i]->literal, std::string(full.buffer.literal(i)));
+    }
+
+    EXPECT_EQ(result.begin, expected.begin);
+    EXPECT_EQ(result.removed, expected.removed);
+    EXPECT_EQ(result.inserted, expected.inserted);
+  }
+
+  std::string src = "# foo _bar_\n"
+    "baz = 1.5 + 2\n"
+    "foo 3";
+};
+
+TEST_F(IncrementalLexerTest, ReplaceInsideLine) {
+  // "1.5" -> "42.25"
+  testEdit(src, { 18, 3, "42.25" }, { 6, 5, 5 });
+}
+
+TEST_F(IncrementalLexerTest, InsertNewline) {
+  testEdit(src, { 16, 0, "\n" }, { 6, 5, 6 });
+}
+
+TEST_F(IncrementalLexerTest, RemoveAcrossLines) {
+  // removes "_\nbaz"
+  testEdit(src, { 10, 5, "" }, { 0, 11, 8 });
+}
+
+TEST_F(IncrementalLexerTest, AppendToEnd) {
+  testEdit(src, { u_int(src.size()), 0, " + 4\n# x" }, { 12, 2, 7 });
+}
+
+TEST_F(IncrementalLexerTest, EditEmptySource) {
+  testEdit("", { 0, 0, "foo" }, { 0, 0, 1 });
+}
+
+TEST_F(IncrementalLexerTest, SyntaxErrorKeepsTokens) {
+  Lexer lexer(src);
+  lexer.generateTokenBuffer();
+  auto types = lexer.buffer.types;
+
+  EXPECT_THROW(lexer.edit({ 18, 0, "1." }), SYNTAX_ERROR);
+  EXPECT_EQ(lexer.buffer.types, types);
+}
+
+TEST_F(IncrementalLexerTest, EditAfterSyntaxError) {
+  Lexer lexer("a\nb\n");
+  lexer.generateTokens();
+  lexer.generateTokenBuffer();
+
+  EXPECT_THROW(lexer.edit({ 2, 0, "__" }), SYNTAX_ERROR);
+  EXPECT_EQ(lexer.text(), "a\nb\n");
+  lexer.edit({ 0, 1, "zz" });
+
+  Lexer full("zz\nb\n");
+  full.generateTokenBuffer();
+  EXPECT_EQ(lexer.buffer.types, full.buffer.types);
+  EXPECT_EQ(lexer.buffer.offsets, full.buffer.offsets);
+  ASSERT_EQ(lexer.tokens.size(), full.buffer.size());
+  for (u_int i = 0; i < lexer.tokens.size(); ++i) {
+    EXPECT_EQ(lexer.tokens[i]->literal, std::string(full.buffer.literal(i)));
+  }
+
+  // a borrowed source is given back too
+  std::string edited = "zz\n__\n";
+  EXPECT_THROW(lexer.relex(edited, { 3, 1, "__" }), SYNTAX_ERROR);
+  EXPECT_EQ(lexer.text(), "zz\nb\n");
+}
+
+TEST_F(IncrementalLexerTest, EditOutOfSource) {
+  Lexer lexer(src);
+  lexer.generateTokenBuffer();
+  auto types = lexer.buffer.types;
+
+  EXPECT_THROW(lexer.edit({ u_int(src.size()) + 1, 0, "x" }), std::out_of_range);
+  EXPECT_THROW(lexer.edit({ 10, u_int(src.size()), "" }), std::out_of_range);
+  EXPECT_THROW(lexer.relex("x", { 0, 0, "x" }), std::out_of_range);
+  EXPECT_EQ(lexer.text(), src);
+  EXPECT_EQ(lexer.buffer.types, types);
+}
+
+TEST_F(IncrementalLexerTest, EditBeforeBuffer) {
+  Lexer lexer(src);
+  lexer.generateTokens();
+
+  EXPECT_THROW(lexer.edit({ 0, 0, "x" }), std::logic_error);
+  EXPECT_EQ(lexer.text(), src);
+}
+
+// tokens that generateTokens did not make are left alone, even when they
+// happen to be as many as the buffer
+TEST_F(IncrementalLexerTest, KeepTokensNotInStep) {
+  Lexer lexer(src);
+  lexer.generateTokenBuffer();
+  auto other = token::make(TokenType::WORD, "other", FIRST_LOCATION);
+  lexer.tokens = Tokens(lexer.buffer.size(), other);
+
+  lexer.edit({ 0, 0, "x\n" });
+  ASSERT_EQ(lexer.tokens.size(), lexer.buffer.size() - 2);
+  for (auto& token : lexer.tokens) {
+    EXPECT_EQ(token, other);
+  }
+  EXPECT_EQ(other->location, FIRST_LOCATION);
+}
+
+TEST_F(IncrementalLexerTest, EditDropsFixedProblems) {
+  Lexer lexer("foo __ bar\n1.2.3\n4");
+  lexer.recover = true;
+  lexer.generateTokenBuffer();
+  ASSERT_EQ(lexer.diagnostics.size(), 2);
+
+  // "__" -> "x", the problem of the next line moves back with it
+  lexer.edit({ 4, 2, "x" });
+  ASSERT_EQ(lexer.diagnostics.size(), 1);
+  EXPECT_EQ(lexer.diagnostics[0].msg, "Number has more than one dot");
+  EXPECT_EQ(lexer.diagnostics[0].location, FIRST_LOCATION + 13);
+}
+
+TEST_F(IncrementalLexerTest, SkipBlocksInsideLine) {
+  std::string doc = "# foo\n```\nx = 1\n```\nbaz = 2\n";
+  Lexer lexer(doc);
+  lexer.skipBlocks = true;
+  lexer.generateTokens();
+  lexer.generateTokenBuffer();
+
+  // "2" -> "42", the fence stays as it was
+  auto result = lexer.edit({ 26, 1, "42" });
+  EXPECT_EQ(result.begin, 3);
+  EXPECT_EQ(result.removed, 3);
+  EXPECT_EQ(result.inserted, 3);
+  EXPECT_EQ(lexer.buffer.literal(5), "42");
+}
+
+TEST_F(IncrementalLexerTest, SkipBlocksOpenFence) {
+  std::string doc = "# foo\nbar\nx = 1\nbaz = 2\n";
+  Lexer lexer(doc);
+  lexer.skipBlocks = true;
+  lexer.generateTokens();
+  lexer.generateTokenBuffer();
+
+  // "bar" -> "```" hides everything after it
+  auto result = lexer.edit({ 6, 3, "```" });
+  EXPECT_EQ(result.begin, 0);
+  EXPECT_EQ(result.removed, 13);
+  EXPECT_EQ(result.inserted, 3);
+  ASSERT_EQ(lexer.tokens.size(), 4);
+  EXPECT_EQ(lexer.tokens[2]->type, TokenType::ENDL);
+  EXPECT_EQ(lexer.buffer.types, std::vector<uint8_t>({ uint8_t(TokenType::HASH), uint8_t(TokenType::WORD), uint8_t(TokenType::ENDL), uint8_t(TokenType::END_OF_FILE) }));
+}
+
+// the edited line turns blank or stops being blank, its ENDL goes or comes
+TEST_F(IncrementalLexerTest, SkipBlocksBlankLine) {
+  for (auto [doc, change] : { std::pair<std::string, SourceEdit>{ "a\nb\nc", { 2, 1, "" } },
+    { "a\n\nc", { 2, 0, "b" } }, { "a\n  \nc", { 3, 0, "b" } }, { "a\nb\nc\n", { 2, 1, " " } } }) {
+    Lexer lexer(doc);
+    lexer.skipBlocks = true;
+    lexer.generateTokens();
+    lexer.generateTokenBuffer();
+    lexer.edit(change);
+
+    doc.replace(change.offset, change.removed, change.inserted);
+    Lexer full(doc);
+    full.skipBlocks = true;
+    full.generateTokenBuffer();
+    EXPECT_EQ(lexer.buffer.types, full.buffer.types) << doc;
+    EXPECT_EQ(lexer.buffer.offsets, full.buffer.offsets) << doc;
+    ASSERT_EQ(lexer.tokens.size(), full.buffer.size()) << doc;
+    for (u_int i = 0; i < lexer.tokens.size(); ++i) {
+      EXPECT_EQ(lexer.tokens[i]->type, full.buffer.type(i)) << doc;
+    }
+  }
+}
+
+TEST_F(LexerTest, PullTokens) {
+  l = Lexer("foo = 1\nbar");
+
+  EXPECT_EQ(l.peek(2)->type, TokenType::NUMBER);
+  EXPECT_EQ(l.peek()->literal, "foo");
+  EXPECT_EQ(l.next()->literal, "foo");
+  EXPECT_EQ(l.next()->type, TokenType::EQUALS);
+  EXPECT_EQ(l.next()->type, TokenType::NUMBER);
+  EXPECT_EQ(l.peek(1)->literal, "bar");
+  EXPECT_EQ(l.next()->type, TokenType::ENDL);
+  EXPECT_EQ(l.next()->literal, "bar");
+  EXPECT_EQ(l.next()->type, TokenType::END_OF_FILE);
+  EXPECT_EQ(l.next()->type, TokenType::END_OF_FILE);
+  EXPECT_THROW(l.peek(Lexer::lookahead), std::out_of_range);
+}
+
+TEST_F(LexerTest, EverySpecLexemeLexesToItsType) {
+  for (auto& spec : tokenSpecs) {
+    if (spec.lexeme.empty()) {
+      continue;
+    }
+
+    generateTokensFromSource(std::string(spec.lexeme));
+    ASSERT_EQ(l.tokens.size(), 2) << spec.name;
+    EXPECT_EQ(l.tokens[0]->type, spec.type) << spec.name;
+    EXPECT_EQ(l.tokens[0]->literal, spec.lexeme);
+    EXPECT_EQ(stringToTokenType.at(std::string(spec.name)), spec.type);
+    EXPECT_EQ(tokenTypeToString[spec.type], spec.name);
+  }
+}
+
+TEST_F(LexerTest, TokenTypeSet) {
+  TokenTypeSet set = { TokenType::WORD, TokenType::END_OF_FILE };
+  EXPECT_TRUE(set.contains(TokenType::WORD));
+  EXPECT_TRUE(set.contains(TokenType::END_OF_FILE));
+  EXPECT_FALSE(set.contains(TokenType::UNDEFINED));
+  EXPECT_TRUE(TokenTypeSet().empty());
+  EXPECT_EQ(set | TokenType::HASH, TokenTypeSet({ TokenType::HASH, TokenType::WORD, TokenType::END_OF_FILE }));
+
+  EXPECT_EQ(token::END, TokenTypeSet({ TokenType::ENDL, TokenType::END_OF_FILE }));
+  EXPECT_TRUE(token::PREFIX.contains(TokenType::MINUS));
+  EXPECT_TRUE(token::INFIX.contains(TokenType::MINUS));
+  EXPECT_FALSE(token::INFIX.contains(TokenType::BANG));
+
+  auto minus = token::make(TokenType::MINUS, "-");
+  EXPECT_TRUE(minus->isTypeOf(token::INFIX));
+  EXPECT_FALSE(minus->isTypeOf(token::END));
+}
+
+TEST_F(LexerTest, TokenTraits) {
+  EXPECT_EQ(tokenTraits(TokenType::ASTERISK).precedence, ExprOrder::PPRODUCT);
+  EXPECT_EQ(tokenTraits(TokenType::LT_OR_EQUALS).precedence, ExprOrder::LESSGREATER);
+  EXPECT_EQ(tokenTraits(TokenType::WORD).precedence, ExprOrder::LOWEST);
+  for (auto& spec : tokenSpecs) {
+    // only infix operators bind
+    EXPECT_EQ(spec.precedence != ExprOrder::LOWEST, token::INFIX.contains(spec.type)) << spec.name;
+    EXPECT_EQ(Token(spec.type).literal, spec.name);
+  }
+}
+
+TEST_F(LexerTest, DoubleUnderscore) {
+  EXPECT_THROW(generateTokensFromSource("foo __"), SYNTAX_ERROR);
+}
+
+TEST_F(LexerTest, RecoverFromSyntaxErrors) {
+  l = Lexer("foo __ bar\n1.2.3\n4");
+  l.recover = true;
+  l.generateTokens();
+
+  TokenTesters expectedTokens = {
+      {TokenType::WORD, "foo"},
+      {TokenType::INVALID, "__"},
+      {TokenType::WORD, "bar"},
+      {TokenType::ENDL, "\n"},
+      {TokenType::INVALID, "1.2.3"},
+      {TokenType::ENDL, "\n"},
+      {TokenType::NUMBER, "4"},
+      {TokenType::END_OF_FILE, ""} };
+  testTokens(expectedTokens);
+
+  // located from the first byte at FIRST_LOCATION
+  ASSERT_EQ(l.diagnostics.size(), 2);
+  EXPECT_EQ(l.diagnostics[0].msg, "Double underscore is not supported");
+  EXPECT_EQ(l.diagnostics[0].location, FIRST_LOCATION + 4);
+  EXPECT_EQ(l.diagnostics[1].msg, "Number has more than one dot");
+  EXPECT_EQ(l.diagnostics[1].location, FIRST_LOCATION + 14);
+}
+
+TEST_F(LexerTest, TokenLocations) {
+  l = Lexer::borrow("# name\n  12 + x", 100);
+  l.generateTokens();
+  std::vector<SourceLocation> locations;
+  for (auto& token : l.tokens) {
+    locations.push_back(token->location);
+  }
+  EXPECT_THAT(locations, ElementsAre(100, 102, 106, 109, 112, 114, 115));
+
+  l.generateTokenBuffer();
+  for (u_int i = 0; i < l.buffer.size(); ++i) {
+    EXPECT_EQ(l.buffer.toToken(i)->location, locations[i]);
+  }
+
+  // the tokens after an edit move with it
+  l.edit({ 9, 2, "3456" });
+  EXPECT_EQ(l.tokens[3]->location, 109);
+  EXPECT_EQ(l.tokens[4]->location, 114);
+  EXPECT_EQ(l.tokens[5]->location, 116);
+}
+
+TEST_F(LexerTest, UnicodeWords) {
+  std::string source = "# Äiti söi jäätelöä\n"
+    "Straße naïve Привет 日本語 x²";
+  generateTokensFromSource(source);
+
+  TokenTesters expectedTokens = {
+      {TokenType::HASH, "#"},
+      {TokenType::WORD, "Äiti"},
+      {TokenType::WORD, "söi"},
+      {TokenType::WORD, "jäätelöä"},
+      {TokenType::ENDL, "\n"},
+      {TokenType::WORD, "Straße"},
+      {TokenType::WORD, "naïve"},
+      {TokenType::WORD, "Привет"},
+      {TokenType::WORD, "日本語"},
+      {TokenType::WORD, "x"},
+      {TokenType::UNDEFINED, "²"},
+      {TokenType::END_OF_FILE, ""} };
+
+  testTokens(expectedTokens);
+}
+
+TEST_F(LexerTest, CombiningMarksContinueWords) {
+  // e followed by a combining acute accent
+  std::string source = "cafe\xCC\x81 \xCC\x81";
+  generateTokensFromSource(source);
+
+  TokenTesters expectedTokens = {
+      {TokenType::WORD, "cafe\xCC\x81"},
+      {TokenType::UNDEFINED, "\xCC\x81"},
+      {TokenType::END_OF_FILE, ""} };
+
+  testTokens(expectedTokens);
+}
+
+TEST_F(LexerTest, NonLetterAndMalformedUtf8) {
+  std::string source = "5 € \xff\xfe s\xC3";
+  generateTokensFromSource(source);
+
+  TokenTesters expectedTokens = {
+      {TokenType::NUMBER, "5"},
+      {TokenType::UNDEFINED, "€"},
+      {TokenType::UNDEFINED, "\xff"},
+      {TokenType::UNDEFINED, "\xfe"},
+      {TokenType::WORD, "s"},
+      {TokenType::UNDEFINED, "\xC3"},
+      {TokenType::END_OF_FILE, ""} };
+
+  testTokens(expectedTokens);
+}
+
+TEST_F(LexerTest, SkipBlocks) {
+  std::string source = "# Add _x_\n"
+    "\n"
+    "```\n"
+    "not `lexed` __ 1.2.3\n"
+    "```\n"
+    "   \n"
+    "x + 1\n"
+    "~~~\n"
+    "unclosed";
+  std::string code = "# Add _x_\n"
+    "x + 1\n";
+
+  Lexer expected(code);
+  expected.generateTokenBuffer();
+
+  l = Lexer(source);
+  l.skipBlocks = true;
+  l.generateTokens();
+  l.generateTokenBuffer();
+
+  ASSERT_EQ(l.tokens.size(), expected.buffer.size());
+  EXPECT_EQ(l.buffer.types, expected.buffer.types);
+  for (u_int i = 0; i < l.tokens.size(); ++i) {
+    EXPECT_EQ(l.tokens[i]->literal, std::string(expected.buffer.literal(i)));
+  }
+  EXPECT_EQ(l.buffer.offsets[6], source.find("x + 1"));
+
+  Lexer pulled(source);
+  pulled.skipBlocks = true;
+  for (u_int i = 0; i < l.tokens.size(); ++i) {
+    EXPECT_EQ(pulled.next()->literal, l.tokens[i]->literal);
+  }
+
+  // the second ~~~ closes the fence of the first copy
+  Lexer serial(source + "\n" + source);
+  serial.skipBlocks = true;
+  serial.threads = 1;
+  serial.generateTokenBuffer();
+  EXPECT_EQ(serial.buffer.literal(serial.buffer.size() - 2), "unclosed");
+
+  Lexer parallel(source + "\n" + source);
+  parallel.skipBlocks = true;
+  parallel.threads = 3;
+  parallel.parallelThreshold = 0;
+  parallel.generateTokenBuffer();
+  EXPECT_EQ(parallel.buffer.types, serial.buffer.types);
+  EXPECT_EQ(parallel.buffer.offsets, serial.buffer.offsets);
+}
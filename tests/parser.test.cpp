@@ -1,4 +1,5 @@
 #include <gmock/gmock.h>
+#include <thread>
 #include "lexer.h"
 #include "parser.h"
 #include "preparser.h"
@@ -19,6 +20,21 @@ public:
     EXPECT_EQ(expected, p.scope->toString());
     EXPECT_EQ(astTree, p.scope->typeToString(0));
   }
+
+  // error of the single pass parse of the first expression statement
+  std::string parseError(std::string src) {
+    l = Lexer(src);
+    l.generateTokens();
+    pp = PreParser(l.tokens);
+    pp.prepareFromStart();
+
+    auto statement = pp.scoped->tokens.front();
+    auto processor = ExpressionStatementProc(pp.scoped);
+    pParserError error;
+    auto node = processor.parse(statement, error);
+    EXPECT_EQ(node, nullptr);
+    return error != nullptr ? error->msg : "";
+  }
   Lexer l;
   PreParser pp;
   Parser p;
@@ -63,3 +79,199 @@ TEST_F(ParserTest, ParseCallWithArgument) {
 
   testParser(src, expected, astTree);
 }
+
+TEST_F(ParserTest, ParseCallInExpression) {
+  std::string src = "test + 1\n"
+    "# test";
+  std::string expected = "(test + 1)\n"
+    "# test\n";
+
+  std::string astTree = "PROGRAM\n"
+    "  EXPRESSION_STATEMENT->CALL(0) + NUMBER\n"
+    "  DECLARATION IDENTIFIER\n"
+    "  PROGRAM\n";
+  testParser(src, expected, astTree);
+}
+
+TEST_F(ParserTest, ParseStatementInDeclaration) {
+  std::string src = "# test\n"
+    "1";
+  std::string expected = "# test\n"
+    "1\n";
+
+  std::string astTree = "PROGRAM\n"
+    "  DECLARATION IDENTIFIER\n"
+    "  PROGRAM\n"
+    "    EXPRESSION_STATEMENT->NUMBER\n";
+  testParser(src, expected, astTree);
+}
+
+TEST_F(ParserTest, ParseErrors) {
+  EXPECT_EQ(parseError("1 +"), "Expression Processor: expression ends unexpectedly");
+  EXPECT_EQ(parseError("1 + * 2"), "Expression Processor: Expected prefix token or identifier but got *, literal: *");
+  EXPECT_EQ(parseError("unknown + 1"), "Expression Processor: unknown identifier: unknown");
+}
+
+TEST_F(ParserTest, ParseWithRuntimeProcessors) {
+  std::string src = "test _1_ + 2\n"
+    "# test _foo_";
+  testParser(src, "(test _1_ + 2)\n# test _foo_\n", "PROGRAM\n"
+    "  EXPRESSION_STATEMENT->CALL(1) + NUMBER\n"
+    "  DECLARATION IDENTIFIER\n"
+    "  PROGRAM\n");
+
+  Parser registered(pp.scoped);
+  registered.processors = {
+    std::make_shared<ExpressionStatementProc>(pp.scoped),
+    std::make_shared<DeclarationProc>(pp.scoped) };
+  registered.parseScope();
+  EXPECT_EQ(registered.scope->toString(), p.scope->toString());
+}
+
+TEST_F(ParserTest, ResolveCallByPhrase) {
+  l = Lexer("# name _a_\n"
+    "# name\n"
+    "## name _b_\n"
+    "## other _c_ name\n"
+    "name _1_ + other _2_ name + name\n");
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  auto scope = pp.scoped.get();
+  while (!scope->narrower.empty()) {
+    scope = scope->narrowerScope(scope->narrower.size() - 1);
+  }
+  auto statement = std::static_pointer_cast<PreToken>(scope->tokens.back());
+  TokenSpan expression(std::static_pointer_cast<PreToken>(statement->tokens.front())->tokens);
+  auto processor = CallProc(pp.arena->at<PreScope>(scope->index));
+  auto outer = pp.scoped.get();
+  auto inner = scope->broaderScope();
+  while (inner->identifiers.empty()) {
+    inner = inner->broaderScope();
+  }
+  ASSERT_NE(inner, outer);
+
+  // the narrowest declaration shadows the broader one with the same shape
+  EXPECT_EQ(processor.checkLine(expression, expression.begin()), inner->identifiers[0]);
+  // parameters match anything in their slot, words must be the same
+  EXPECT_EQ(processor.checkLine(expression, expression.begin() + 2), inner->identifiers[1]);
+  EXPECT_EQ(processor.checkLine(expression, expression.end() - 1), outer->identifiers[1]);
+  // a phrase declared only in the broader scope is not found in the inner one
+  auto& plain = *outer->identifiers[1];
+  EXPECT_EQ(inner->findPhrase(plain, phrase::shape(plain)), nullptr);
+}
+
+TEST_F(ParserTest, ResolveCallOncePerPhrase) {
+  testParser("test _1_ + test _2_ * other\n"
+    "test _3_\n"
+    "# test _foo_\n"
+    "# other", "(test _1_ + (test _2_ * other))\n"
+    "test _3_\n"
+    "# test _foo_\n"
+    "# other\n", "PROGRAM\n"
+    "  EXPRESSION_STATEMENT->CALL(1) + CALL(1) * CALL(0)\n"
+    "  EXPRESSION_STATEMENT->CALL(1)\n"
+    "  DECLARATION IDENTIFIER\n"
+    "  PROGRAM\n"
+    "    DECLARATION IDENTIFIER\n"
+    "    PROGRAM\n");
+
+  // one entry per distinct phrase, shared by the lines of the scope
+  auto& calls = *p.calls;
+  ASSERT_EQ(calls.size(), 2);
+  for (auto& phrase : calls) {
+    ASSERT_EQ(phrase.second.size(), 1);
+  }
+  auto& test = calls[phrase::shape(*pp.scoped->identifiers[0])];
+  ASSERT_EQ(test.size(), 1);
+  EXPECT_EQ(test[0], pp.scoped->identifiers[0]);
+}
+
+TEST_F(ParserTest, ParseOperatorPrecedence) {
+  std::string src = "1 + 2 * 3 - 4 / 2 < 7 == -1 != !2";
+  std::string expected = "(((((1 + (2 * 3)) - (4 / 2)) < 7) == -1) != !2)\n";
+
+  std::string astTree = "PROGRAM\n"
+    "  EXPRESSION_STATEMENT->NUMBER + NUMBER * NUMBER - NUMBER / NUMBER < NUMBER == -NUMBER != !NUMBER\n";
+
+  testParser(src, expected, astTree);
+}
+
+TEST_F(ParserTest, ParseScopesOnPool) {
+  std::string src = "# vocabulary\n";
+  for (int i = 0; i < 40; ++i) {
+    std::string name(i % 26 + 1, 'a' + i % 26);
+    src += "## section " + name + "\n"
+      "### entry " + name + " _x_\n"
+      "entry " + name + " _1_ + 2\n"
+      "section " + name + " * 3\n"
+      + (i % 7 == 0 ? "missing + 1\n" : "")
+      + "vocabulary - 1\n";
+  }
+  src += "# other\n"
+    "1 +\n";
+  l = Lexer(src);
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  Parser serial(pp.scoped);
+  serial.parseScope();
+
+  ThreadPool pool(4);
+  for (int run = 0; run < 5; ++run) {
+    Parser parallel(pp.scoped);
+    parallel.pool = &pool;
+    parallel.parseScope();
+
+    EXPECT_EQ(parallel.scope->toString(), serial.scope->toString());
+    ASSERT_EQ(parallel.diagnostics.size(), serial.diagnostics.size());
+    for (size_t i = 0; i < serial.diagnostics.size(); ++i) {
+      EXPECT_EQ(parallel.diagnostics[i].msg, serial.diagnostics[i].msg);
+      EXPECT_EQ(parallel.diagnostics[i].location, serial.diagnostics[i].location);
+    }
+  }
+  EXPECT_EQ(serial.diagnostics.size(), 7);
+}
+
+// the pre scope tree is read only while parsing, so parsers can share it
+TEST_F(ParserTest, ParseOneTreeConcurrently) {
+  std::string src = "# vocabulary\n";
+  for (int i = 0; i < 20; ++i) {
+    std::string name(i % 26 + 1, 'a' + i % 26);
+    src += "## entry " + name + " _x_\n"
+      "entry " + name + " _1_ + vocabulary * 2\n"
+      "entry " + name + " _2_ - missing\n";
+  }
+  l = Lexer(src);
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  Parser serial(pp.scoped);
+  serial.parseScope();
+
+  std::vector<std::string> programs(4);
+  std::vector<size_t> problems(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < programs.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      for (int run = 0; run < 20; ++run) {
+        Parser parser(pp.scoped);
+        parser.parseScope();
+        programs[i] = parser.scope->toString();
+        problems[i] = parser.diagnostics.size();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < programs.size(); ++i) {
+    EXPECT_EQ(programs[i], serial.scope->toString());
+    EXPECT_EQ(problems[i], serial.diagnostics.size());
+  }
+  EXPECT_EQ(serial.diagnostics.size(), 20);
+}
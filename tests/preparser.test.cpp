@@ -75,4 +75,127 @@ TEST_F(PreParserTest, TestPreParserScopedIdentifiers) {
     "      deep\n";
 
   testIdentifiers(src, expected);
-}
\ No newline at end of file
+}
+
+TEST_F(PreParserTest, TestPreParserFromLexer) {
+  std::string src = "2 + 3 * test _1_ and _2_\n"
+    "# test _foo_ and _bar_\n"
+    "[description](#link-to-nearest-method)\n"
+    "\n"
+    "## foobar\n"
+    "baz = 3";
+
+  l = Lexer(src);
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  Lexer pulled(src);
+  PreParser fromLexer;
+  fromLexer.prepareFromLexer(pulled);
+
+  EXPECT_EQ(token::verboseTokensWithoutSpaces(fromLexer.parsedTokens), token::verboseTokensWithoutSpaces(pp.parsedTokens));
+  EXPECT_EQ(fromLexer.scoped->verboseIdentifiersRecursively(), pp.scoped->verboseIdentifiersRecursively());
+}
+
+TEST_F(PreParserTest, TestPreParserSkipsBlocks) {
+  std::string src = "# test _foo_\n"
+    "\n"
+    "```\n"
+    "example = `not able`\n"
+    "```\n"
+    "baz = 3";
+
+  Lexer lexer(src);
+  lexer.skipBlocks = true;
+  PreParser skipped;
+  skipped.prepareFromLexer(lexer);
+
+  EXPECT_EQ("[0]\n"
+    "# test _foo_\n"
+    "[1]\n"
+    "baz = 3\n", token::verboseTokensWithoutSpaces(skipped.parsedTokens));
+}
+
+TEST_F(PreParserTest, TestPreParserArena) {
+  std::string src = "test = 1\n"
+    "# test _foo_ and _bar_\n"
+    "## foobar\n"
+    "bazzer = 2\n"
+    "### baz\n"
+    "deep = 3";
+
+  l = Lexer(src);
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  for (PreIndex i = 0; i < pp.arena->size(); ++i) {
+    EXPECT_EQ(pp.arena->at(i)->index, i);
+  }
+
+  auto root = pp.scoped;
+  ASSERT_EQ(root->narrower.size(), 1);
+  auto narrower = root->narrowerScope(0);
+  EXPECT_EQ(narrower->broaderScope(), root.get());
+  EXPECT_EQ(narrower->narrowerScope(0)->broaderScope(), narrower);
+  EXPECT_EQ(root->broaderScope(), nullptr);
+
+  // no reference cycles: the graph goes away with the pre parser
+  std::weak_ptr<PreScope> deepest = pp.arena->at<PreScope>(narrower->narrowerScope(0)->index);
+  std::weak_ptr<PreToken> identifier = narrower->identifiers[0];
+  root = nullptr;
+  pp = PreParser();
+  EXPECT_TRUE(deepest.expired());
+  EXPECT_TRUE(identifier.expired());
+}
+
+TEST_F(PreParserTest, TestPreParserRuntimeProcessors) {
+  std::string src = "test = 1\n"
+    "# test _foo_\n"
+    "2 + test _3_";
+
+  l = Lexer(src);
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.prepareFromStart();
+
+  // the same processors registered at runtime give the same statements
+  PreParser registered(l.tokens);
+  registered.addProcessor(std::make_shared<DefinitionProcessor>());
+  registered.addProcessor(std::make_shared<AssignmentProcessor>());
+  registered.addProcessor(std::make_shared<ExpressionStatementProcessor>());
+  registered.prepareFromStart();
+
+  EXPECT_EQ(token::verboseTokensWithoutSpaces(registered.parsedTokens), token::verboseTokensWithoutSpaces(pp.parsedTokens));
+  EXPECT_EQ(registered.scoped->verboseIdentifiersRecursively(), pp.scoped->verboseIdentifiersRecursively());
+
+  // only definitions
+  PreParser definitions(l.tokens);
+  definitions.addProcessor(std::make_shared<DefinitionProcessor>());
+  definitions.prepareFromStart();
+  EXPECT_EQ("[0]\n"
+    "# test _foo_\n"
+    "[1]\n", token::verboseTokensWithoutSpaces(definitions.parsedTokens));
+}
+
+// accepts every statement but does not make a pre token
+class NothingProcessor: public PreProcessor {
+public:
+  bool check(Tokens&, Tokens::iterator) { return true; }
+  std::shared_ptr<PreToken> parse(Tokens&, Tokens::iterator&, std::shared_ptr<PreProcessorError>&) { return nullptr; }
+};
+
+TEST_F(PreParserTest, TestPreParserProcessorWithoutResult) {
+  l = Lexer("test = 1\n"
+    "2");
+  l.generateTokens();
+  pp = PreParser(l.tokens);
+  pp.addProcessor(std::make_shared<NothingProcessor>());
+  pp.prepareFromStart();
+
+  EXPECT_EQ("[0]\n", token::verboseTokensWithoutSpaces(pp.parsedTokens));
+  ASSERT_EQ(pp.diagnostics.size(), 2);
+  EXPECT_EQ(pp.diagnostics[0].msg, "Preprocessor error: could not create the statement");
+  EXPECT_EQ(pp.diagnostics[1].location, l.tokens[l.tokens.size() - 2]->location);
+}
@@ -14,8 +14,9 @@ struct PreProcessorTest: public Test {
         Tokens::iterator it = t.begin();
 
         bool check = p->check(t, it);
-        auto error = p->verify(t, it);
-        auto result = p->create(t, it);
+        EXPECT_EQ(p->check(t, preprocessor::classifyLine(t, 0)), check);
+        std::shared_ptr<PreProcessorError> error;
+        auto result = p->parse(t, it, error);
 
         if (error != nullptr) {
             std::cout << error->msg << "\n";
@@ -23,7 +24,24 @@ struct PreProcessorTest: public Test {
 
         EXPECT_TRUE(check);
         EXPECT_EQ(error, nullptr);
+        ASSERT_NE(result, nullptr);
         EXPECT_EQ(result->verboseToken(), expected);
+        // the statement is read without running past its line
+        EXPECT_LE(std::distance(t.begin(), it), preprocessor::classifyLine(t, 0).end);
+    }
+
+    void testParseError(std::shared_ptr<PreProcessor> p, std::string src, std::string expected) {
+        l = Lexer(src);
+        l.generateTokens();
+        Tokens t = l.tokens;
+        Tokens::iterator it = t.begin();
+
+        std::shared_ptr<PreProcessorError> error;
+        auto parsed = p->parse(t, it, error);
+
+        ASSERT_NE(error, nullptr);
+        EXPECT_EQ(error->msg, expected);
+        EXPECT_EQ(parsed, nullptr);
     }
 
     void testDefinition(std::string src, std::string expected) {
@@ -113,4 +131,67 @@ TEST_F(PreProcessorTest, TestImport) {
     std::string expected = "[#test]";
 
     testImport(src, expected);
-}
\ No newline at end of file
+}
+
+TEST_F(PreProcessorTest, TestParseErrors) {
+    testParseError(std::make_shared<DefinitionProcessor>(), "# test + 1", "Definition: unexpected token: +");
+    testParseError(std::make_shared<DefinitionProcessor>(), "# test _ _", "Definition: Parameter: parameter is missing");
+    testParseError(std::make_shared<AssignmentProcessor>(), "test =", "Assignment: Cannot assign empty");
+    testParseError(std::make_shared<AssignmentProcessor>(), "test = 1 ?", "Expression: Illigal symbol: ?");
+    testParseError(std::make_shared<ImportProcessor>(), "[foo](bar", "Import: Closing brace is missing.");
+    testParseError(std::make_shared<ImportProcessor>(), "[foo]()", "Import: Link should not be empty");
+    testParseError(std::make_shared<ExpressionStatementProcessor>(), "1 + [foo] 2", "Expression: unexpected token: ]");
+}
+
+TEST_F(PreProcessorTest, TestHelpersOnTokenBuffer) {
+    l = Lexer("## foo bar = 1");
+    l.generateTokenBuffer();
+    auto it = l.buffer.begin();
+    auto end = l.buffer.end();
+
+    EXPECT_EQ(preprocessor::expectMultiple(it, end, { TokenType::HASH }), 2);
+    EXPECT_EQ(preprocessor::fastForwardUntil(it, end, { TokenType::EQUALS }), 2);
+    EXPECT_TRUE(preprocessor::expect(it, end, { TokenType::NUMBER }));
+    EXPECT_EQ(preprocessor::fastForwardUntil(it, end, { TokenType::BANG }), -1);
+
+    // without an END token the scans stop at the end of the span
+    Tokens hashes = { std::make_shared<Token>(TokenType::HASH), std::make_shared<Token>(TokenType::HASH) };
+    auto hash = hashes.begin();
+    EXPECT_EQ(preprocessor::expectMultiple(hash, hashes.end(), { TokenType::HASH }), -1);
+    EXPECT_EQ(hash, hashes.end());
+    hash = hashes.begin();
+    EXPECT_EQ(preprocessor::fastForwardUntil(hash, hashes.end(), { TokenType::EQUALS }), -1);
+    EXPECT_FALSE(preprocessor::expect(hash, hashes.end(), { TokenType::HASH }));
+}
+
+TEST_F(PreProcessorTest, TestLineTable) {
+    l = Lexer("## a = b = 1\n"
+              "\n"
+              "[description](link) + x = 2");
+    l.generateTokens();
+
+    auto table = preprocessor::lineTable(l.tokens, 0);
+    ASSERT_EQ(table.size(), 3);
+
+    EXPECT_EQ(table[0].start, 0);
+    EXPECT_EQ(table[0].end, 7);
+    EXPECT_EQ(table[0].depth, 2);
+    EXPECT_EQ(table[0].equals, 3);
+    EXPECT_FALSE(table[0].import);
+
+    EXPECT_EQ(table[1].start, 8);
+    EXPECT_EQ(table[1].end, 8);
+
+    EXPECT_EQ(table[2].start, 9);
+    EXPECT_EQ(table[2].depth, 0);
+    EXPECT_EQ(table[2].equals, 17);
+    EXPECT_TRUE(table[2].import);
+    EXPECT_TRUE(l.tokens[table[2].end]->isTypeOf(TokenType::END_OF_FILE));
+
+    AssignmentProcessor assignment;
+    ImportProcessor import;
+    EXPECT_TRUE(assignment.check(l.tokens, table[0]));
+    EXPECT_FALSE(assignment.check(l.tokens, table[1]));
+    EXPECT_TRUE(import.check(l.tokens, table[2]));
+    EXPECT_FALSE(import.check(l.tokens, table[0]));
+}
@@ -0,0 +1,86 @@
+#include <gmock/gmock.h>
+#include "scan.h"
+#include "lexer.h"
+
+using namespace ::testing;
+
+class ScanTest: public Test {
+public:
+  ScanTest() {}
+
+  std::vector<const scan::Kernels*> supportedKernels() {
+    std::vector<const scan::Kernels*> result = { &scan::scalar() };
+    if (scan::hasSse2()) {
+      result.push_back(&scan::sse2());
+    }
+    if (scan::hasAvx2()) {
+      result.push_back(&scan::avx2());
+    }
+    return result;
+  }
+
+  // compare every kernel against the scalar one from every starting offset
+  void testKernels(std::string src) {
+    auto& reference = scan::scalar();
+    for (auto kernels : supportedKernels()) {
+      for (size_t i = 0; i <= src.size(); ++i) {
+        auto p = src.data() + i;
+        auto n = src.size() - i;
+        EXPECT_EQ(kernels->wordRun(p, n), reference.wordRun(p, n)) << kernels->name << " word at " << i;
+        EXPECT_EQ(kernels->numberRun(p, n), reference.numberRun(p, n)) << kernels->name << " number at " << i;
+        EXPECT_EQ(kernels->spaceRun(p, n), reference.spaceRun(p, n)) << kernels->name << " space at " << i;
+        EXPECT_EQ(kernels->untilNewline(p, n), reference.untilNewline(p, n)) << kernels->name << " newline at " << i;
+      }
+    }
+  }
+};
+
+TEST_F(ScanTest, ScalarRuns) {
+  std::string src = "x-times.md2 1.25     end\nnext";
+  auto& k = scan::scalar();
+
+  EXPECT_EQ(k.wordRun(src.data(), src.size()), 11);
+  EXPECT_EQ(k.numberRun(src.data() + 12, src.size() - 12), 4);
+  EXPECT_EQ(k.spaceRun(src.data() + 16, src.size() - 16), 5);
+  EXPECT_EQ(k.untilNewline(src.data(), src.size()), 24);
+}
+
+TEST_F(ScanTest, VectorKernelsMatchScalar) {
+  testKernels("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  testKernels("Add x times y to z and print the result of the whole phrase\n# next");
+  testKernels("1234567890.1234567890123456789012345678901234567890 foo");
+  testKernels("                                                      foo\n");
+  testKernels("@[`{/:azAZ09.-_ \x7f\x80\xff\xc3\xa4iti" "                                 ");
+}
+
+// every byte on its own, in a full vector block and in the scalar tail
+TEST_F(ScanTest, KernelsFollowByteClasses) {
+  for (auto kernels : supportedKernels()) {
+    for (int c = 0; c < 256; ++c) {
+      std::string block(64, char(c));
+      for (size_t n : { size_t(1), block.size() }) {
+        EXPECT_EQ(kernels->wordRun(block.data(), n) == n, scan::isWordByte(c)) << kernels->name << " " << c;
+        EXPECT_EQ(kernels->numberRun(block.data(), n) == n, scan::isNumberByte(c)) << kernels->name << " " << c;
+      }
+    }
+  }
+}
+
+TEST_F(ScanTest, LexerKernelsProduceSameTokens) {
+  std::string src = "# Add _x_ times _y_ to _z_\n"
+    "result = 1.5 + 300 * add 3 times 5 to 2       \n"
+    "a-very-long-identifier-that-spans-more-than-thirty-two-bytes.md";
+
+  Lexer scalar(src);
+  scalar.kernels = &scan::scalar();
+  scalar.generateTokenBuffer();
+
+  Lexer vector(src);
+  vector.generateTokenBuffer();
+
+  ASSERT_EQ(scalar.buffer.size(), vector.buffer.size());
+  for (u_int i = 0; i < scalar.buffer.size(); ++i) {
+    EXPECT_EQ(scalar.buffer.type(i), vector.buffer.type(i));
+    EXPECT_EQ(scalar.buffer.literal(i), vector.buffer.literal(i));
+  }
+}
@@ -0,0 +1,90 @@
+#include <gmock/gmock.h>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+#include <unistd.h>
+#include "frontend.h"
+#include "sourceManager.h"
+
+using namespace ::testing;
+
+class SourceManagerTest: public Test {
+public:
+  std::string write(const std::string& text) {
+    char path[] = "/tmp/sourceManagerXXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    std::ofstream(path, std::ios::binary) << text;
+    paths.push_back(path);
+    return path;
+  }
+
+  void TearDown() override {
+    for (auto& path : paths) {
+      std::remove(path.c_str());
+    }
+  }
+
+  std::vector<std::string> paths;
+  SourceManager sources;
+};
+
+TEST_F(SourceManagerTest, MapFiles) {
+  auto path = write("1 + 2\n# name\n");
+  auto file = sources.open(path);
+  EXPECT_EQ(sources.text(file), "1 + 2\n# name\n");
+  EXPECT_EQ(sources.name(file), path);
+
+  auto empty = sources.open(write(""));
+  EXPECT_EQ(sources.text(empty), "");
+  EXPECT_EQ(sources.size(), 2);
+
+  EXPECT_THROW(sources.open("/tmp/no/such/source"), std::system_error);
+}
+
+TEST_F(SourceManagerTest, LocateLinesAndColumns) {
+  auto first = sources.add("first", "ab\n\ncd");
+  auto second = sources.add("second", "x\ny");
+
+  auto at = sources.position(sources.location(first, 0));
+  EXPECT_EQ(at.file, "first");
+  EXPECT_EQ(at.line, 1);
+  EXPECT_EQ(at.column, 1);
+
+  at = sources.position(sources.location(first, 3));
+  EXPECT_EQ(at.line, 2);
+  EXPECT_EQ(at.column, 1);
+
+  // the end of a source is still in it
+  at = sources.position(sources.location(first, 6));
+  EXPECT_EQ(at.file, "first");
+  EXPECT_EQ(at.line, 3);
+  EXPECT_EQ(at.column, 3);
+
+  at = sources.position(sources.location(second, 2));
+  EXPECT_EQ(at.file, "second");
+  EXPECT_EQ(at.line, 2);
+  EXPECT_EQ(at.column, 1);
+  EXPECT_EQ(sources.fileOf(sources.location(second, 3)), second);
+
+  EXPECT_THROW(sources.position(NO_LOCATION), std::out_of_range);
+  EXPECT_THROW(sources.position(sources.location(second, 4)), std::out_of_range);
+}
+
+TEST_F(SourceManagerTest, CompileFile) {
+  auto file = sources.open(write("1 + 2\n"
+    "  foo __ bar\n"
+    "unknown\n"));
+  // locations of a second source are past the first one
+  sources.add("other", "1");
+  auto compilation = frontend::compile(sources, file);
+
+  ASSERT_EQ(compilation.diagnostics.size(), 2);
+  EXPECT_EQ(compilation.diagnostics[0].msg, "Double underscore is not supported");
+  EXPECT_EQ(compilation.diagnostics[0].line, 2);
+  EXPECT_EQ(compilation.diagnostics[0].column, 7);
+  EXPECT_EQ(sources.fileOf(compilation.diagnostics[0].location), file);
+  EXPECT_EQ(compilation.diagnostics[1].line, 3);
+  EXPECT_EQ(compilation.diagnostics[1].column, 1);
+  EXPECT_EQ(compilation.program->toString(), "(1 + 2)\n");
+}
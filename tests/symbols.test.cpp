@@ -0,0 +1,135 @@
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "symbols.h"
+#include "lexer.h"
+
+using namespace ::testing;
+
+TEST(SymbolTableTest, InternsEqualStringsOnce) {
+  SymbolTable table;
+  auto foo = table.intern("foo");
+  auto bar = table.intern("bar");
+
+  EXPECT_NE(foo, 0);
+  EXPECT_NE(foo, bar);
+  EXPECT_EQ(table.intern(std::string("fo") + "o"), foo);
+  EXPECT_EQ(table.find("bar"), bar);
+  EXPECT_EQ(table.find("baz"), 0);
+  EXPECT_EQ(table.view(foo), "foo");
+  EXPECT_EQ(table.view(0), "");
+  EXPECT_EQ(table.size(), 2);
+}
+
+TEST(SymbolTableTest, ViewsStayValid) {
+  SymbolTable table;
+  auto first = table.view(table.intern("first"));
+  for (int i = 0; i < 10000; ++i) {
+    table.intern("word" + std::to_string(i));
+  }
+  EXPECT_EQ(first, "first");
+}
+
+// the cache of this thread does not hand out symbols from before the reset
+TEST(SymbolTableTest, Reset) {
+  auto before = symbols::current();
+  uint32_t generation = 0;
+  symbols::intern("first", generation);
+  EXPECT_EQ(generation, before->generation);
+  symbols::reset();
+
+  auto after = symbols::current();
+  EXPECT_NE(after, before);
+  EXPECT_EQ(after->generation, before->generation + 1);
+  EXPECT_EQ(after->size(), 0);
+  auto second = symbols::intern("second", generation);
+  EXPECT_EQ(generation, after->generation);
+  EXPECT_EQ(symbols::view(second), "second");
+  EXPECT_EQ(after->find("second"), second);
+  EXPECT_EQ(after->find("first"), 0);
+  // the old table lives on for whoever holds it
+  EXPECT_NE(before->find("first"), 0);
+}
+
+// a token from before the reset is not equal to an other word that got its
+// symbol in the next generation, and still equal to the same word
+TEST(SymbolTableTest, TokensAcrossGenerations) {
+  Word old("old");
+  symbols::reset();
+  Word same("old");
+  std::vector<Word> words;
+  for (Symbol i = 0; i <= old.symbol; ++i) {
+    words.emplace_back("new" + std::to_string(i));
+  }
+
+  auto collision = std::find_if(words.begin(), words.end(), [&](Word& w) { return w.symbol == old.symbol; });
+  ASSERT_NE(collision, words.end());
+  EXPECT_FALSE(*collision == old);
+  EXPECT_TRUE(same == old);
+  EXPECT_NE(same.generation, old.generation);
+}
+
+TEST(SymbolTableTest, ResetWhileLexing) {
+  std::atomic<bool> done = false;
+  std::thread resets([&done]() {
+    while (!done) {
+      symbols::reset();
+      std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < 2000; ++i) {
+    auto lexer = Lexer("foo bar foo " + std::to_string(i) + "\nbar");
+    lexer.generateTokens();
+    lexer.generateTokenBuffer();
+    ASSERT_TRUE(lexer.tokens[0] == lexer.tokens[2]);
+    ASSERT_TRUE(lexer.tokens[1] == lexer.tokens[5]);
+    ASSERT_FALSE(lexer.tokens[0] == lexer.tokens[1]);
+    ASSERT_EQ(lexer.buffer.symbol(0), lexer.buffer.symbol(2));
+    ASSERT_EQ(lexer.buffer.symbol(1), lexer.buffer.symbol(5));
+    ASSERT_EQ(lexer.buffer.table->view(lexer.buffer.symbol(1)), "bar");
+  }
+  done = true;
+  resets.join();
+}
+
+TEST(SymbolTableTest, ConcurrentInterning) {
+  SymbolTable table;
+  const int threadCount = 4;
+  std::vector<std::vector<Symbol>> results(threadCount);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&table, &results, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        results[t].push_back(table.intern("word" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(table.size(), 1000);
+  for (int t = 1; t < threadCount; ++t) {
+    EXPECT_EQ(results[t], results[0]);
+  }
+}
+
+TEST(SymbolTableTest, WordsCarrySymbols) {
+  auto lexer = Lexer("foo bar foo 1");
+  lexer.generateTokens();
+  lexer.generateTokenBuffer();
+
+  EXPECT_NE(lexer.tokens[0]->symbol, 0);
+  EXPECT_EQ(lexer.tokens[0]->symbol, lexer.tokens[2]->symbol);
+  EXPECT_NE(lexer.tokens[0]->symbol, lexer.tokens[1]->symbol);
+  EXPECT_EQ(lexer.tokens[3]->symbol, 0);
+  EXPECT_EQ(symbols::view(lexer.tokens[1]->symbol), "bar");
+
+  EXPECT_EQ(lexer.buffer.symbol(0), lexer.tokens[0]->symbol);
+  EXPECT_EQ(lexer.buffer.symbol(2), lexer.tokens[0]->symbol);
+  EXPECT_EQ(lexer.buffer.symbol(3), 0);
+  EXPECT_TRUE(*lexer.tokens[0] == Word("foo"));
+}
@@ -0,0 +1,125 @@
+#include <gmock/gmock.h>
+#include <random>
+#include "frontend.h"
+#include "syntaxTree.h"
+
+using namespace ::testing;
+
+class SyntaxTreeTest: public Test {
+public:
+  // tokens of the tree have to be the ones lexing its text gives
+  void expectLexed(const SyntaxTree& tree, const std::string& src) {
+    ASSERT_EQ(tree.text(), src);
+    auto lexer = Lexer(src);
+    lexer.recover = true;
+    lexer.generateTokens();
+
+    auto tokens = tree.tokens();
+    ASSERT_EQ(tokens.size(), lexer.tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      EXPECT_EQ(tokens[i]->type, lexer.tokens[i]->type) << i;
+      EXPECT_EQ(tokens[i]->literal, lexer.tokens[i]->literal) << i;
+      EXPECT_EQ(tokens[i]->location, lexer.tokens[i]->location) << i;
+    }
+
+    auto diagnostics = tree.diagnostics();
+    ASSERT_EQ(diagnostics.size(), lexer.diagnostics.size());
+    for (size_t i = 0; i < diagnostics.size(); ++i) {
+      EXPECT_EQ(diagnostics[i].msg, lexer.diagnostics[i].msg);
+      EXPECT_EQ(diagnostics[i].location, lexer.diagnostics[i].location);
+    }
+  }
+
+  std::string lines(size_t count) {
+    std::string src;
+    for (size_t i = 0; i < count; ++i) {
+      src += i % 3 == 0 ? "# name " + std::to_string(i + 1) + "\n" : "  value = 2 * 3 + " + std::to_string(i + 1) + "\n";
+    }
+    return src;
+  }
+};
+
+TEST_F(SyntaxTreeTest, KeepEveryByte) {
+  for (std::string src : { "", "\n", "1 + 2", "  1  +  2  \n\n   ", "foo __ bar\n1.2.3\n# name\n" }) {
+    expectLexed(SyntaxTree::parse(src), src);
+  }
+  auto tree = SyntaxTree::parse(lines(2000));
+  EXPECT_EQ(tree.lineCount(), 2001);
+  EXPECT_EQ(tree.line(1000).offset, lines(1000).length());
+  EXPECT_EQ(tree.lineAt(lines(1000).length() + 3).index, 1000);
+}
+
+TEST_F(SyntaxTreeTest, EditLines) {
+  std::string src = "1 + 2\n# name\n3 * 4\n";
+  auto tree = SyntaxTree::parse(src);
+  std::vector<SourceEdit> edits = {
+    { 4, 1, "33" },           // in a line
+    { 6, 0, "\n\n" },         // new lines
+    { 5, 1, "" },             // join two lines
+    { 0, 9, "x __ y" },       // across lines, with a problem
+    { 0, 0, "" },
+    { 13, 0, " 5 \n6 " },     // at the end
+    { 0, 19, "" },            // everything
+    { 0, 0, "# a\na + 1" },
+  };
+  for (auto& edit : edits) {
+    ASSERT_LE(edit.offset + edit.removed, src.length());
+    src.replace(edit.offset, edit.removed, edit.inserted);
+    tree = tree.edit(edit);
+    expectLexed(tree, src);
+  }
+}
+
+TEST_F(SyntaxTreeTest, EditsMatchFullParse) {
+  std::string src = lines(1500);
+  auto tree = SyntaxTree::parse(src);
+  std::mt19937 random(7);
+  const char* inserts[] = { "", "x", "\n", " + 1", "\n# other\n", "__", "2\n3\n4\n" };
+
+  for (int i = 0; i < 200; ++i) {
+    u_int offset = random() % (src.length() + 1);
+    u_int removed = std::min<u_int>(random() % 40, src.length() - offset);
+    std::string inserted = inserts[random() % 7];
+    src.replace(offset, removed, inserted);
+    tree = tree.edit({ offset, removed, inserted });
+    ASSERT_EQ(tree.text(), src) << i;
+  }
+  expectLexed(tree, src);
+}
+
+TEST_F(SyntaxTreeTest, ShareUntouchedLines) {
+  auto before = SyntaxTree::parse(lines(1000));
+  auto edited = before.line(500);
+  auto after = before.edit({ edited.offset + 2, 0, "x" });
+
+  EXPECT_NE(after.line(500).green, edited.green);
+  for (u_int i : { 0, 31, 499, 501, 999 }) {
+    EXPECT_EQ(after.line(i).green, before.line(i).green) << i;
+  }
+  // only the groups on the path to the root are new
+  u_int shared = 0;
+  for (size_t i = 0; i < after.root->children.size(); ++i) {
+    shared += after.root->children[i] == before.root->children[i];
+  }
+  EXPECT_EQ(shared, after.root->children.size() - 1);
+  EXPECT_EQ(before.text(), lines(1000));
+}
+
+TEST_F(SyntaxTreeTest, CompileTree) {
+  std::string src = "# name\n"
+    "name + 1\n"
+    "foo __ bar\n"
+    "unknown\n";
+  auto tree = SyntaxTree::parse(src).edit({ 14, 1, "2" });
+  src.replace(14, 1, "2");
+
+  auto expected = frontend::compile(src);
+  auto compilation = frontend::compile(tree);
+  EXPECT_EQ(compilation.program->toString(), expected.program->toString());
+  ASSERT_EQ(compilation.diagnostics.size(), 2);
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(compilation.diagnostics[i].msg, expected.diagnostics[i].msg);
+    EXPECT_EQ(compilation.diagnostics[i].line, expected.diagnostics[i].line);
+    EXPECT_EQ(compilation.diagnostics[i].column, expected.diagnostics[i].column);
+  }
+}
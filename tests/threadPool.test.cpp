@@ -0,0 +1,89 @@
+#include <gmock/gmock.h>
+#include <stdexcept>
+#include "threadPool.h"
+
+using namespace ::testing;
+
+TEST(ThreadPoolTest, RunAndWait) {
+  ThreadPool pool(4);
+  ThreadPool::Group group;
+  std::atomic<u_int> sum = 0;
+  for (u_int i = 1; i <= 1000; ++i) {
+    pool.run(group, [&sum, i]() { sum += i; });
+  }
+  pool.wait(group);
+  EXPECT_EQ(sum, 500500);
+}
+
+TEST(ThreadPoolTest, TasksWaitForTheirOwn) {
+  ThreadPool pool(2);
+  std::function<u_int(u_int)> count = [&](u_int depth) -> u_int {
+    if (depth == 0) {
+      return 1;
+    }
+    ThreadPool::Group group;
+    u_int left = 0;
+    u_int right = 0;
+    pool.run(group, [&]() { left = count(depth - 1); });
+    pool.run(group, [&]() { right = count(depth - 1); });
+    pool.wait(group);
+    return left + right;
+  };
+
+  ThreadPool::Group group;
+  u_int leaves = 0;
+  pool.run(group, [&]() { leaves = count(10); });
+  pool.wait(group);
+  EXPECT_EQ(leaves, 1024);
+}
+
+TEST(ThreadPoolTest, SingleThread) {
+  ThreadPool pool(1);
+  EXPECT_EQ(pool.size(), 1);
+  ThreadPool::Group group;
+  u_int runs = 0;
+  for (u_int i = 0; i < 100; ++i) {
+    pool.run(group, [&runs]() { ++runs; });
+  }
+  pool.wait(group);
+  EXPECT_EQ(runs, 100);
+}
+
+TEST(ThreadPoolTest, WaitRethrowsTaskException) {
+  ThreadPool pool(2);
+  ThreadPool::Group group;
+  std::atomic<u_int> runs = 0;
+  for (u_int i = 0; i < 100; ++i) {
+    pool.run(group, [&runs, i]() {
+      ++runs;
+      if (i % 10 == 0) {
+        throw std::runtime_error("task " + std::to_string(i));
+      }
+    });
+  }
+  EXPECT_THROW(pool.wait(group), std::runtime_error);
+  EXPECT_EQ(runs, 100);
+
+  // the group is done and can be used again
+  pool.run(group, [&runs]() { ++runs; });
+  pool.wait(group);
+  EXPECT_EQ(runs, 101);
+}
+
+// the waiter sleeps while a worker runs the last task
+TEST(ThreadPoolTest, WaitForRunningTask) {
+  ThreadPool pool(1);
+  ThreadPool::Group group;
+  std::atomic<bool> started = false;
+  std::atomic<bool> done = false;
+  pool.run(group, [&]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done = true;
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  pool.wait(group);
+  EXPECT_TRUE(done);
+}